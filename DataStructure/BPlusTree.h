@@ -0,0 +1,635 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+// 内存中的 B+ 树有序 map，接口与 RBMap.h 中的 rb_map 相同
+//
+// - 结点大小按字节指定（默认 512 字节，8 条 cache line），一个结点放几十个 key，
+//   树高只有红黑树的 1/4 左右，查找时 cache miss 少得多；
+// - key 与 value 分成两个数组存放，结点内查找只扫 key 数组；整数 key 配合 std::less 时
+//   用 SIMD 一次比较 4 个 key（64 位用 AVX2，32 位用 SSE2），数出小于目标的个数就是下标，
+//   没有分支预测失败；其它 key 类型在结点内二分；
+// - 所有元素都在叶子中，叶子之间用双向链表相连，范围扫描和遍历是顺序访问数组；
+// - 删除时叶子 / 内部结点少于半满就向兄弟借或与兄弟合并，树始终保持平衡。
+//
+// 与 rb_map 的区别：元素在结点间移动，插入、删除会使所有迭代器失效；
+// key 与 value 不是存放在一起的 pair，迭代器的 operator* 返回 pair<const K &, V &>；
+// K 和 V 需要能默认构造和移动赋值。
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace bplus_detail {
+
+// 有序数组 keys[0, n) 中满足 keys[i] < x（Greater 为 false）或 keys[i] > x（Greater 为 true）的个数。
+// 按 4 个一组比较，最后一组可能读到 n 之后的元素（结点数组容量是 4 的倍数），用掩码去掉。
+// 无符号数先异或符号位，再用有符号比较。
+template <bool Greater, class K>
+inline int count_simd(const K *keys, int n, K x) {
+	typedef typename std::make_signed<K>::type S;
+	const S bias = std::is_signed<K>::value ? 0 : std::numeric_limits<S>::min();
+	int c = 0;
+#if defined(__AVX2__)
+	if (sizeof(K) == 8) {
+		__m256i vb = _mm256_set1_epi64x(bias);
+		__m256i vx = _mm256_set1_epi64x(static_cast<S>(x) ^ bias);
+		for (int i = 0; i < n; i += 4) {
+			__m256i k = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), vb);
+			__m256i r = Greater ? _mm256_cmpgt_epi64(k, vx) : _mm256_cmpgt_epi64(vx, k);
+			unsigned m = _mm256_movemask_pd(_mm256_castsi256_pd(r));
+			if (n - i < 4) m &= (1u << (n - i)) - 1;
+			c += __builtin_popcount(m);
+		}
+		return c;
+	}
+#endif
+#if defined(__SSE2__)
+	if (sizeof(K) == 4) {
+		__m128i vb = _mm_set1_epi32(bias);
+		__m128i vx = _mm_set1_epi32(static_cast<S>(x) ^ bias);
+		for (int i = 0; i < n; i += 4) {
+			__m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), vb);
+			__m128i r = Greater ? _mm_cmpgt_epi32(k, vx) : _mm_cmpgt_epi32(vx, k);
+			unsigned m = _mm_movemask_ps(_mm_castsi128_ps(r));
+			if (n - i < 4) m &= (1u << (n - i)) - 1;
+			c += __builtin_popcount(m);
+		}
+		return c;
+	}
+#endif
+	// 没有对应指令集时逐个比较，但不提前退出，编译器可以展开或向量化
+	for (int i = 0; i < n; ++i) c += Greater ? x < keys[i] : keys[i] < x;
+	return c;
+}
+
+// 结点内查找：lower 返回第一个不小于 x 的下标，upper 返回第一个大于 x 的下标
+template <class K, class Compare, class Enable = void>
+struct searcher {
+	static int lower(const K *keys, int n, const K &x, const Compare &comp) {
+		return static_cast<int>(std::lower_bound(keys, keys + n, x, comp) - keys);
+	}
+	static int upper(const K *keys, int n, const K &x, const Compare &comp) {
+		return static_cast<int>(std::upper_bound(keys, keys + n, x, comp) - keys);
+	}
+};
+
+template <class K>
+struct searcher<K, std::less<K>,
+				typename std::enable_if<std::is_integral<K>::value && (sizeof(K) == 4 || sizeof(K) == 8)>::type> {
+	static int lower(const K *keys, int n, K x, const std::less<K> &) { return count_simd<false>(keys, n, x); }
+	static int upper(const K *keys, int n, K x, const std::less<K> &) { return n - count_simd<true>(keys, n, x); }
+};
+
+// 每个结点可以放的元素个数：向下取整到 4 的倍数，至少 4 个，最多 64 个
+inline constexpr int capacity(int bytes, int header, int per_item) {
+	return (bytes - header) / per_item / 4 * 4 < 4 ? 4
+		: (bytes - header) / per_item / 4 * 4 > 64 ? 64
+		: (bytes - header) / per_item / 4 * 4;
+}
+
+struct node {
+	int n;
+	bool leaf;
+};
+
+// 结点按 cache line 对齐分配
+inline void *allocate(size_t size) {
+	void *p;
+	if (posix_memalign(&p, 64, size) != 0) throw std::bad_alloc();
+	return p;
+}
+
+}  // namespace bplus_detail
+
+template <class K, class V, class Compare = std::less<K>, int NodeBytes = 512>
+class bplus_map {
+	typedef bplus_detail::node node;
+	typedef bplus_detail::searcher<K, Compare> searcher;
+public:
+	static const int kLeafCap = bplus_detail::capacity(NodeBytes, sizeof(node) + 2 * sizeof(void *), sizeof(K) + sizeof(V));
+	static const int kInnerCap = bplus_detail::capacity(NodeBytes, sizeof(node) + sizeof(void *), sizeof(K) + sizeof(void *));
+	static const int kLeafMin = kLeafCap / 2;
+	static const int kInnerMin = kInnerCap / 2;
+private:
+	struct leaf_node : node {
+		leaf_node *prev;
+		leaf_node *next;
+		K keys[kLeafCap];
+		V values[kLeafCap];
+		leaf_node() : prev(NULL), next(NULL), keys(), values() { this->n = 0; this->leaf = true; }
+	};
+	// children[i] 中的 key 都不小于 keys[i - 1]、小于 keys[i]
+	struct inner_node : node {
+		K keys[kInnerCap];
+		node *children[kInnerCap + 1];
+		inner_node() : keys(), children() { this->n = 0; this->leaf = false; }
+	};
+	// 从根到叶子的路径：经过的内部结点和走向的孩子下标
+	struct step {
+		inner_node *inner;
+		int idx;
+	};
+	static const int kMaxDepth = 32;
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef Compare key_compare;
+	typedef size_t size_type;
+
+	template <bool Const>
+	class iter {
+		friend class bplus_map;
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef std::pair<const K, V> value_type;
+		typedef typename std::conditional<Const, const V, V>::type mapped;
+		typedef ptrdiff_t difference_type;
+		typedef std::pair<const K &, mapped &> reference;
+		// operator-> 返回的临时对象，使 it->first / it->second 可以使用
+		struct pointer {
+			reference ref;
+			const reference *operator->() const { return &ref; }
+		};
+
+		iter() : leaf_(NULL), idx_(0) { }
+		// 普通迭代器可以转换为 const 迭代器
+		template <bool OtherConst, class = typename std::enable_if<Const && !OtherConst>::type>
+		iter(const iter<OtherConst> &other) : leaf_(other.leaf_), idx_(other.idx_) { }
+		reference operator*() const { return reference(leaf_->keys[idx_], leaf_->values[idx_]); }
+		pointer operator->() const { pointer p = {**this}; return p; }
+		const K &key() const { return leaf_->keys[idx_]; }
+		mapped &value() const { return leaf_->values[idx_]; }
+		// 到达叶子末尾时转到下一个叶子；最后一个叶子的末尾就是 end()
+		iter &operator++() {
+			if (++idx_ == leaf_->n && leaf_->next) {
+				leaf_ = leaf_->next;
+				idx_ = 0;
+			}
+			return *this;
+		}
+		iter operator++(int) { iter tmp = *this; ++*this; return tmp; }
+		iter &operator--() {
+			if (idx_ == 0) {
+				leaf_ = leaf_->prev;
+				idx_ = leaf_->n;
+			}
+			--idx_;
+			return *this;
+		}
+		iter operator--(int) { iter tmp = *this; --*this; return tmp; }
+	private:
+		friend class iter<!Const>;
+		iter(const leaf_node *leaf, int idx) : leaf_(const_cast<leaf_node *>(leaf)), idx_(idx) { }
+		leaf_node *leaf_;
+		int idx_;
+	};
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	// 非成员函数，iterator 与 const_iterator 可以互相比较（见 rb_map）
+	friend bool operator==(const const_iterator &a, const const_iterator &b) { return same_pos(a, b); }
+	friend bool operator!=(const const_iterator &a, const const_iterator &b) { return !(a == b); }
+
+	explicit bplus_map(const Compare &comp = Compare()) : comp_(comp), size_(0), height_(0), nodes_(0) { reset(); }
+	bplus_map(const bplus_map &other) : comp_(other.comp_), size_(0), height_(0), nodes_(0) {
+		reset();
+		// 元素已经有序，依次追加到最后一个叶子
+		for (const_iterator it = other.begin(); it != other.end(); ++it) append(it->first, it->second);
+	}
+	bplus_map(bplus_map &&other) : comp_(other.comp_), size_(0), height_(0), nodes_(0) {
+		reset();
+		swap(other);
+	}
+	bplus_map &operator=(bplus_map other) { swap(other); return *this; }
+	~bplus_map() { destroy(root_); }
+
+	void swap(bplus_map &other) {
+		std::swap(comp_, other.comp_);
+		std::swap(root_, other.root_);
+		std::swap(first_, other.first_);
+		std::swap(last_, other.last_);
+		std::swap(size_, other.size_);
+		std::swap(height_, other.height_);
+		std::swap(nodes_, other.nodes_);
+	}
+
+	iterator begin() { return iterator(first_, 0); }
+	iterator end() { return iterator(last_, last_->n); }
+	const_iterator begin() const { return const_iterator(first_, 0); }
+	const_iterator end() const { return const_iterator(last_, last_->n); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	// 内部结点的层数，只有一个叶子时为 0
+	int height() const { return height_; }
+	// 所有结点占用的字节数
+	size_t memory_usage() const { return nodes_.leaves * sizeof(leaf_node) + nodes_.inners * sizeof(inner_node); }
+
+	void clear() {
+		destroy(root_);
+		size_ = 0;
+		height_ = 0;
+		nodes_ = counts(0);
+		reset();
+	}
+
+	iterator find(const K &key) { return mutable_iterator(find_pos(key)); }
+	const_iterator find(const K &key) const { return find_pos(key); }
+	size_t count(const K &key) const { return find(key) != end(); }
+	bool contains(const K &key) const { return find(key) != end(); }
+
+	// 第一个不小于 key 的元素
+	iterator lower_bound(const K &key) { return mutable_iterator(bound(key, false)); }
+	const_iterator lower_bound(const K &key) const { return bound(key, false); }
+	// 第一个大于 key 的元素
+	iterator upper_bound(const K &key) { return mutable_iterator(bound(key, true)); }
+	const_iterator upper_bound(const K &key) const { return bound(key, true); }
+	std::pair<iterator, iterator> equal_range(const K &key) {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+	std::pair<const_iterator, const_iterator> equal_range(const K &key) const {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+
+	V &at(const K &key) {
+		iterator it = find(key);
+		if (it == end()) throw std::out_of_range("bplus_map::at");
+		return it.value();
+	}
+	const V &at(const K &key) const {
+		const_iterator it = find(key);
+		if (it == end()) throw std::out_of_range("bplus_map::at");
+		return it.value();
+	}
+
+	V &operator[](const K &key) { return try_emplace(key).first.value(); }
+
+	std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(const K &key, Args &&... args) {
+		step path[kMaxDepth];
+		leaf_node *leaf = descend(key, path);
+		int pos = searcher::lower(leaf->keys, leaf->n, key, comp_);
+		if (pos < leaf->n && !comp_(key, leaf->keys[pos])) return std::make_pair(iterator(leaf, pos), false);
+		return std::make_pair(insert_at(path, leaf, pos, key, V(std::forward<Args>(args)...)), true);
+	}
+
+	template <class... Args>
+	std::pair<iterator, bool> emplace(Args &&... args) {
+		value_type value(std::forward<Args>(args)...);
+		return try_emplace(value.first, std::move(value.second));
+	}
+
+	size_t erase(const K &key) {
+		step path[kMaxDepth];
+		leaf_node *leaf = descend(key, path);
+		int pos = searcher::lower(leaf->keys, leaf->n, key, comp_);
+		if (pos == leaf->n || comp_(key, leaf->keys[pos])) return 0;
+		erase_at(path, leaf, pos);
+		return 1;
+	}
+	// 返回下一个元素的迭代器；删除后结点可能合并，所以记下后继的 key 重新查找
+	iterator erase(const_iterator pos) {
+		const_iterator next = pos;
+		if (++next == end()) {
+			erase(pos.key());
+			return end();
+		}
+		K next_key = next.key();
+		erase(pos.key());
+		return lower_bound(next_key);
+	}
+	iterator erase(const_iterator first, const_iterator last) {
+		if (first == begin() && last == end()) {
+			clear();
+			return end();
+		}
+		if (last == end()) {
+			while (first != end()) first = erase(first);
+			return end();
+		}
+		K last_key = last.key();
+		for (iterator it = mutable_iterator(first); it != end() && comp_(it.key(), last_key);) it = erase(it);
+		return lower_bound(last_key);
+	}
+
+	key_compare key_comp() const { return comp_; }
+
+private:
+	struct counts {
+		explicit counts(size_t v = 0) : leaves(v), inners(v) { }
+		size_t leaves;
+		size_t inners;
+	};
+
+	static iterator mutable_iterator(const_iterator it) { return iterator(it.leaf_, it.idx_); }
+
+	leaf_node *new_leaf() {
+		++nodes_.leaves;
+		return new (bplus_detail::allocate(sizeof(leaf_node))) leaf_node();
+	}
+	inner_node *new_inner() {
+		++nodes_.inners;
+		return new (bplus_detail::allocate(sizeof(inner_node))) inner_node();
+	}
+	void free_leaf(leaf_node *n) {
+		--nodes_.leaves;
+		n->~leaf_node();
+		free(n);
+	}
+	void free_inner(inner_node *n) {
+		--nodes_.inners;
+		n->~inner_node();
+		free(n);
+	}
+	static bool same_pos(const const_iterator &a, const const_iterator &b) {
+		return a.leaf_ == b.leaf_ && a.idx_ == b.idx_;
+	}
+	void destroy(node *n) {
+		if (n->leaf) {
+			free_leaf(static_cast<leaf_node *>(n));
+			return;
+		}
+		inner_node *in = static_cast<inner_node *>(n);
+		for (int i = 0; i <= in->n; ++i) destroy(in->children[i]);
+		free_inner(in);
+	}
+	// 空树也有一个空叶子作为根，end() 总是 (最后一个叶子, 元素个数)
+	void reset() {
+		leaf_node *leaf = new_leaf();
+		root_ = first_ = last_ = leaf;
+	}
+
+	// 从根走到 key 所在的叶子，path 记录经过的内部结点（可以为 NULL）
+	leaf_node *descend(const K &key, step *path) const {
+		node *x = root_;
+		for (int d = 0; d < height_; ++d) {
+			inner_node *in = static_cast<inner_node *>(x);
+			int i = searcher::upper(in->keys, in->n, key, comp_);
+			if (path) {
+				path[d].inner = in;
+				path[d].idx = i;
+			}
+			x = in->children[i];
+		}
+		return static_cast<leaf_node *>(x);
+	}
+	const_iterator find_pos(const K &key) const {
+		leaf_node *leaf = descend(key, NULL);
+		int pos = searcher::lower(leaf->keys, leaf->n, key, comp_);
+		if (pos == leaf->n || comp_(key, leaf->keys[pos])) return end();
+		return const_iterator(leaf, pos);
+	}
+	const_iterator bound(const K &key, bool upper) const {
+		leaf_node *leaf = descend(key, NULL);
+		int pos = upper ? searcher::upper(leaf->keys, leaf->n, key, comp_)
+			: searcher::lower(leaf->keys, leaf->n, key, comp_);
+		if (pos == leaf->n && leaf->next) return const_iterator(leaf->next, 0);
+		return const_iterator(leaf, pos);
+	}
+
+	static void leaf_insert(leaf_node *leaf, int pos, const K &key, V &&value) {
+		std::move_backward(leaf->keys + pos, leaf->keys + leaf->n, leaf->keys + leaf->n + 1);
+		std::move_backward(leaf->values + pos, leaf->values + leaf->n, leaf->values + leaf->n + 1);
+		leaf->keys[pos] = key;
+		leaf->values[pos] = std::move(value);
+		++leaf->n;
+	}
+	// 把 src[from, src->n) 移到 dst 末尾
+	static void leaf_move(leaf_node *dst, leaf_node *src, int from) {
+		std::move(src->keys + from, src->keys + src->n, dst->keys + dst->n);
+		std::move(src->values + from, src->values + src->n, dst->values + dst->n);
+		dst->n += src->n - from;
+		src->n = from;
+	}
+	void link_after(leaf_node *leaf, leaf_node *right) {
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next) leaf->next->prev = right;
+		else last_ = right;
+		leaf->next = right;
+	}
+	void unlink(leaf_node *leaf) {
+		leaf->prev->next = leaf->next;
+		if (leaf->next) leaf->next->prev = leaf->prev;
+		else last_ = leaf->prev;
+	}
+
+	// 在叶子的 pos 处插入；叶子已满时分裂，左边留一半，右边叶子的第一个 key 插入父结点
+	iterator insert_at(step *path, leaf_node *leaf, int pos, const K &key, V &&value) {
+		++size_;
+		if (leaf->n < kLeafCap) {
+			leaf_insert(leaf, pos, key, std::move(value));
+			return iterator(leaf, pos);
+		}
+		const int mid = (kLeafCap + 1) / 2;
+		leaf_node *right = new_leaf();
+		link_after(leaf, right);
+		iterator it;
+		if (pos < mid) {
+			leaf_move(right, leaf, mid - 1);
+			leaf_insert(leaf, pos, key, std::move(value));
+			it = iterator(leaf, pos);
+		} else {
+			leaf_move(right, leaf, mid);
+			leaf_insert(right, pos - mid, key, std::move(value));
+			it = iterator(right, pos - mid);
+		}
+		insert_parent(path, height_, leaf, right->keys[0], right);
+		return it;
+	}
+
+	// 把分隔 key 和新的右结点插入 left 的父结点，父结点已满时继续向上分裂，根分裂时树长高一层
+	void insert_parent(step *path, int depth, node *left, K key, node *right) {
+		while (depth > 0) {
+			inner_node *p = path[depth - 1].inner;
+			int idx = path[depth - 1].idx;
+			if (p->n < kInnerCap) {
+				std::move_backward(p->keys + idx, p->keys + p->n, p->keys + p->n + 1);
+				std::move_backward(p->children + idx + 1, p->children + p->n + 1, p->children + p->n + 2);
+				p->keys[idx] = std::move(key);
+				p->children[idx + 1] = right;
+				++p->n;
+				return;
+			}
+			// 先拼成 kInnerCap + 1 个 key，中间的 key 上移，两边各自成为一个结点
+			K keys[kInnerCap + 1];
+			node *children[kInnerCap + 2];
+			std::move(p->keys, p->keys + idx, keys);
+			keys[idx] = std::move(key);
+			std::move(p->keys + idx, p->keys + p->n, keys + idx + 1);
+			std::copy(p->children, p->children + idx + 1, children);
+			children[idx + 1] = right;
+			std::copy(p->children + idx + 1, p->children + p->n + 1, children + idx + 2);
+
+			const int mid = (kInnerCap + 1) / 2;
+			inner_node *q = new_inner();
+			std::move(keys, keys + mid, p->keys);
+			std::copy(children, children + mid + 1, p->children);
+			p->n = mid;
+			std::move(keys + mid + 1, keys + kInnerCap + 1, q->keys);
+			std::copy(children + mid + 1, children + kInnerCap + 2, q->children);
+			q->n = kInnerCap - mid;
+
+			left = p;
+			key = std::move(keys[mid]);
+			right = q;
+			--depth;
+		}
+		inner_node *root = new_inner();
+		root->keys[0] = std::move(key);
+		root->children[0] = left;
+		root->children[1] = right;
+		root->n = 1;
+		root_ = root;
+		++height_;
+	}
+
+	// 拷贝构造时使用：key 大于所有已有元素，直接放到最后一个叶子末尾
+	void append(const K &key, const V &value) {
+		step path[kMaxDepth];
+		node *x = root_;
+		for (int d = 0; d < height_; ++d) {
+			inner_node *in = static_cast<inner_node *>(x);
+			path[d].inner = in;
+			path[d].idx = in->n;
+			x = in->children[in->n];
+		}
+		insert_at(path, last_, last_->n, key, V(value));
+	}
+
+	void erase_at(step *path, leaf_node *leaf, int pos) {
+		std::move(leaf->keys + pos + 1, leaf->keys + leaf->n, leaf->keys + pos);
+		std::move(leaf->values + pos + 1, leaf->values + leaf->n, leaf->values + pos);
+		--leaf->n;
+		leaf->keys[leaf->n] = K();
+		leaf->values[leaf->n] = V();
+		--size_;
+		if (height_ == 0 || leaf->n >= kLeafMin) return;
+
+		inner_node *p = path[height_ - 1].inner;
+		int idx = path[height_ - 1].idx;
+		leaf_node *left = idx > 0 ? static_cast<leaf_node *>(p->children[idx - 1]) : NULL;
+		leaf_node *right = idx < p->n ? static_cast<leaf_node *>(p->children[idx + 1]) : NULL;
+		if (left && left->n > kLeafMin) {
+			// 从左兄弟借最后一个元素
+			std::move_backward(leaf->keys, leaf->keys + leaf->n, leaf->keys + leaf->n + 1);
+			std::move_backward(leaf->values, leaf->values + leaf->n, leaf->values + leaf->n + 1);
+			--left->n;
+			leaf->keys[0] = std::move(left->keys[left->n]);
+			leaf->values[0] = std::move(left->values[left->n]);
+			++leaf->n;
+			p->keys[idx - 1] = leaf->keys[0];
+		} else if (right && right->n > kLeafMin) {
+			// 从右兄弟借第一个元素
+			leaf->keys[leaf->n] = std::move(right->keys[0]);
+			leaf->values[leaf->n] = std::move(right->values[0]);
+			++leaf->n;
+			std::move(right->keys + 1, right->keys + right->n, right->keys);
+			std::move(right->values + 1, right->values + right->n, right->values);
+			--right->n;
+			p->keys[idx] = right->keys[0];
+		} else {
+			// 与兄弟合并，总是把右边的并入左边，第一个叶子永远不会被释放
+			if (!left) {
+				left = leaf;
+				leaf = right;
+				++idx;
+			}
+			leaf_move(left, leaf, 0);
+			unlink(leaf);
+			free_leaf(leaf);
+			remove_child(p, idx);
+			rebalance(path, height_ - 1);
+		}
+	}
+
+	// 删除 p 的第 idx 个孩子和它左边的分隔 key
+	static void remove_child(inner_node *p, int idx) {
+		std::move(p->keys + idx, p->keys + p->n, p->keys + idx - 1);
+		std::move(p->children + idx + 1, p->children + p->n + 1, p->children + idx);
+		--p->n;
+	}
+
+	// path[depth] 处的内部结点少了一个孩子：根只剩一个孩子时降低树高，其余结点不足半满时借或合并
+	void rebalance(step *path, int depth) {
+		inner_node *x = path[depth].inner;
+		if (depth == 0) {
+			if (x->n == 0) {
+				root_ = x->children[0];
+				free_inner(x);
+				--height_;
+			}
+			return;
+		}
+		if (x->n >= kInnerMin) return;
+
+		inner_node *p = path[depth - 1].inner;
+		int idx = path[depth - 1].idx;
+		inner_node *left = idx > 0 ? static_cast<inner_node *>(p->children[idx - 1]) : NULL;
+		inner_node *right = idx < p->n ? static_cast<inner_node *>(p->children[idx + 1]) : NULL;
+		if (left && left->n > kInnerMin) {
+			// 右旋：父结点的分隔 key 下移到 x，左兄弟最后一个 key 上移
+			std::move_backward(x->keys, x->keys + x->n, x->keys + x->n + 1);
+			std::move_backward(x->children, x->children + x->n + 1, x->children + x->n + 2);
+			x->keys[0] = std::move(p->keys[idx - 1]);
+			x->children[0] = left->children[left->n];
+			p->keys[idx - 1] = std::move(left->keys[left->n - 1]);
+			--left->n;
+			++x->n;
+		} else if (right && right->n > kInnerMin) {
+			// 左旋
+			x->keys[x->n] = std::move(p->keys[idx]);
+			x->children[x->n + 1] = right->children[0];
+			p->keys[idx] = std::move(right->keys[0]);
+			std::move(right->keys + 1, right->keys + right->n, right->keys);
+			std::move(right->children + 1, right->children + right->n + 1, right->children);
+			--right->n;
+			++x->n;
+		} else {
+			// 合并：分隔 key 下移，右结点并入左结点
+			if (!left) {
+				left = x;
+				x = right;
+				++idx;
+			}
+			left->keys[left->n] = std::move(p->keys[idx - 1]);
+			std::move(x->keys, x->keys + x->n, left->keys + left->n + 1);
+			std::copy(x->children, x->children + x->n + 1, left->children + left->n + 1);
+			left->n += x->n + 1;
+			free_inner(x);
+			remove_child(p, idx);
+			rebalance(path, depth - 1);
+		}
+	}
+
+	Compare comp_;
+	node *root_;
+	leaf_node *first_;
+	leaf_node *last_;
+	size_t size_;
+	int height_;
+	counts nodes_;
+};
+
+#endif
@@ -64,11 +64,15 @@ int Leaves(BiTree T)
 }
 
 // 层次遍历：dep是个全局变量,高度
+// 左右子树的高度各算一次，原来比较后再递归一次取较大值，每层调用次数翻倍，对深度是指数级
 int depTraverse(BiTree T)
 {
+	int l, r;
 	if (NULL == T) return ERROR;
 
-	dep = (depTraverse(T->lchild) > depTraverse(T->rchild)) ? depTraverse(T->lchild) : depTraverse(T->rchild);
+	l = depTraverse(T->lchild);
+	r = depTraverse(T->rchild);
+	dep = l > r ? l : r;
 
 	return dep + 1;
 }
@@ -136,6 +140,255 @@ Status ReplaceRight(BiTree &T, BiTree &RT)
 	return OK;
 }
 
+// ---- 结点池：按块分配结点，整棵树一次释放 ----
+
+// 一块连续的结点，块之间用链表串起来
+typedef struct BiTBlock
+{
+	struct BiTBlock *next;
+	int used, size;
+	BiTNode nodes[1];
+}BiTBlock;
+
+typedef struct
+{
+	BiTBlock *head;
+	int blockSize;		// 下一块的结点数，每次翻倍
+}BiTArena;
+
+// 初始化结点池
+void InitArena(BiTArena &A)
+{
+	A.head = NULL;
+	A.blockSize = 64;
+}
+
+// 从结点池中构建二叉树，结点不需要单独释放
+BiTree ArenaMakeBiTree(BiTArena &A, TElemType e, BiTree L, BiTree R)
+{
+	BiTree t;
+	if (NULL == A.head || A.head->used == A.head->size) {
+		BiTBlock *b = (BiTBlock *)malloc(sizeof(BiTBlock) + (A.blockSize - 1) * sizeof(BiTNode));
+		if (NULL == b) return NULL;
+		b->next = A.head;
+		b->used = 0;
+		b->size = A.blockSize;
+		A.head = b;
+		if (A.blockSize < 65536) A.blockSize *= 2;
+	}
+	t = &A.head->nodes[A.head->used++];
+	t->data = e;
+	t->lchild = L;
+	t->rchild = R;
+	return t;
+}
+
+// 释放结点池中的全部结点
+void DestroyArena(BiTArena &A)
+{
+	while (A.head) {
+		BiTBlock *next = A.head->next;
+		free(A.head);
+		A.head = next;
+	}
+	A.blockSize = 64;
+}
+
+// ---- 非递归遍历：用显式栈 / 队列，树再深也不会栈溢出 ----
+
+// 可增长的结点指针数组，既当栈也当队列
+typedef struct
+{
+	BiTree *base;
+	int front, rear, size;
+}BiTBuffer;
+
+Status InitBuffer(BiTBuffer &B)
+{
+	B.size = 64;
+	B.front = B.rear = 0;
+	B.base = (BiTree *)malloc(B.size * sizeof(BiTree));
+	if (NULL == B.base) return OVERFLOW;
+	return OK;
+}
+
+void DestroyBuffer(BiTBuffer &B)
+{
+	free(B.base);
+	B.base = NULL;
+}
+
+// 在尾部加入
+Status PushBuffer(BiTBuffer &B, BiTree t)
+{
+	if (B.rear == B.size) {
+		// 队列前部已经出队的空间先挪出来用
+		if (B.front > 0) {
+			int n = B.rear - B.front, k;
+			for (k = 0; k < n; k++) B.base[k] = B.base[B.front + k];
+			B.front = 0;
+			B.rear = n;
+		}
+		if (B.rear == B.size) {
+			BiTree *base = (BiTree *)realloc(B.base, 2 * B.size * sizeof(BiTree));
+			if (NULL == base) return OVERFLOW;
+			B.base = base;
+			B.size *= 2;
+		}
+	}
+	B.base[B.rear++] = t;
+	return OK;
+}
+
+// 从尾部取出（栈）
+BiTree PopBack(BiTBuffer &B)
+{
+	return B.base[--B.rear];
+}
+
+// 从头部取出（队列）
+BiTree PopFront(BiTBuffer &B)
+{
+	return B.base[B.front++];
+}
+
+Status BufferEmpty(BiTBuffer &B)
+{
+	return B.front == B.rear ? TRUE : FALSE;
+}
+
+// 先序遍历：弹出结点后先压右孩子再压左孩子
+Status PreOrderIter(BiTree T, Status(*visit)(TElemType e))
+{
+	BiTBuffer S;
+	if (NULL == T) return OK;
+	if (OK != InitBuffer(S)) return OVERFLOW;
+	PushBuffer(S, T);
+	while (!BufferEmpty(S)) {
+		BiTree p = PopBack(S);
+		visit(p->data);
+		if (p->rchild && OK != PushBuffer(S, p->rchild)) { DestroyBuffer(S); return OVERFLOW; }
+		if (p->lchild && OK != PushBuffer(S, p->lchild)) { DestroyBuffer(S); return OVERFLOW; }
+	}
+	DestroyBuffer(S);
+	return OK;
+}
+
+// 中序遍历：一路向左压栈，弹出时访问，再转向右子树
+Status InOrderIter(BiTree T, Status(*visit)(TElemType e))
+{
+	BiTBuffer S;
+	BiTree p = T;
+	if (OK != InitBuffer(S)) return OVERFLOW;
+	while (p || !BufferEmpty(S)) {
+		while (p) {
+			if (OK != PushBuffer(S, p)) { DestroyBuffer(S); return OVERFLOW; }
+			p = p->lchild;
+		}
+		p = PopBack(S);
+		visit(p->data);
+		p = p->rchild;
+	}
+	DestroyBuffer(S);
+	return OK;
+}
+
+// 后序遍历：记录上一个访问的结点，右子树访问完（或为空）时才访问栈顶
+Status PostOrderIter(BiTree T, Status(*visit)(TElemType e))
+{
+	BiTBuffer S;
+	BiTree p = T, last = NULL;
+	if (OK != InitBuffer(S)) return OVERFLOW;
+	while (p || !BufferEmpty(S)) {
+		while (p) {
+			if (OK != PushBuffer(S, p)) { DestroyBuffer(S); return OVERFLOW; }
+			p = p->lchild;
+		}
+		p = S.base[S.rear - 1];
+		if (p->rchild && p->rchild != last) {
+			p = p->rchild;
+		}
+		else {
+			visit(p->data);
+			last = PopBack(S);
+			p = NULL;
+		}
+	}
+	DestroyBuffer(S);
+	return OK;
+}
+
+// Morris 中序遍历：不用栈，O(1) 额外空间。
+// 有左子树时，把左子树最右结点的右指针临时指回当前结点作为回来的线索，第二次经过时拆掉，
+// 遍历结束后树恢复原样
+void MorrisInOrder(BiTree T, Status(*visit)(TElemType e))
+{
+	BiTree p = T, pre;
+	while (p) {
+		if (NULL == p->lchild) {
+			visit(p->data);
+			p = p->rchild;
+			continue;
+		}
+		pre = p->lchild;
+		while (pre->rchild && pre->rchild != p) pre = pre->rchild;
+		if (NULL == pre->rchild) {
+			pre->rchild = p;
+			p = p->lchild;
+		}
+		else {
+			pre->rchild = NULL;
+			visit(p->data);
+			p = p->rchild;
+		}
+	}
+}
+
+// 层序遍历：队列中按层放结点，每次处理一整层，visit 后打印所在层次
+Status LevelOrderTraverse(BiTree T, Status(*visit)(TElemType e))
+{
+	BiTBuffer Q;
+	int lev = 0;
+	if (NULL == T) return OK;
+	if (OK != InitBuffer(Q)) return OVERFLOW;
+	PushBuffer(Q, T);
+	while (!BufferEmpty(Q)) {
+		int n = Q.rear - Q.front, k;
+		lev++;
+		for (k = 0; k < n; k++) {
+			BiTree p = PopFront(Q);
+			visit(p->data);
+			printf("的层次是%d\n", lev);
+			if (p->lchild && OK != PushBuffer(Q, p->lchild)) { DestroyBuffer(Q); return OVERFLOW; }
+			if (p->rchild && OK != PushBuffer(Q, p->rchild)) { DestroyBuffer(Q); return OVERFLOW; }
+		}
+	}
+	DestroyBuffer(Q);
+	return OK;
+}
+
+// 一次层序遍历同时求高度（层数）和叶子数，每个结点只访问一次，O(n)
+Status BiTreeStats(BiTree T, int &height, int &leaves)
+{
+	BiTBuffer Q;
+	height = leaves = 0;
+	if (NULL == T) return OK;
+	if (OK != InitBuffer(Q)) return OVERFLOW;
+	PushBuffer(Q, T);
+	while (!BufferEmpty(Q)) {
+		int n = Q.rear - Q.front, k;
+		height++;
+		for (k = 0; k < n; k++) {
+			BiTree p = PopFront(Q);
+			if (NULL == p->lchild && NULL == p->rchild) leaves++;
+			if (p->lchild && OK != PushBuffer(Q, p->lchild)) { DestroyBuffer(Q); return OVERFLOW; }
+			if (p->rchild && OK != PushBuffer(Q, p->rchild)) { DestroyBuffer(Q); return OVERFLOW; }
+		}
+	}
+	DestroyBuffer(Q);
+	return OK;
+}
+
 // 合并二叉树
 void UnionBiTree(BiTree &Ttemp)
 {
@@ -175,6 +428,28 @@ int main()
 
 	printf("高度是 %d\n", depTraverse(T));
 
+	// 非递归遍历
+	printf("先序：");
+	PreOrderIter(T, visit1);
+	printf("\n中序：");
+	InOrderIter(T, visit1);
+	printf("\n后序：");
+	PostOrderIter(T, visit1);
+	printf("\nMorris 中序：");
+	MorrisInOrder(T, visit1);
+	printf("\n");
+	LevelOrderTraverse(T, visit1);
+
+	// 结点池中的深树：100000 层的左斜树，递归遍历会栈溢出，这里只用非递归的统计
+	BiTArena A;
+	BiTree deep = NULL;
+	int height, leaves, k;
+	InitArena(A);
+	for (k = 0; k < 100000; k++) deep = ArenaMakeBiTree(A, 'X', deep, k % 2 ? ArenaMakeBiTree(A, 'Y', NULL, NULL) : NULL);
+	BiTreeStats(deep, height, leaves);
+	printf("深树的高度是 %d，叶子结点是 %d\n", height, leaves);
+	DestroyArena(A);
+
 	getchar();
 	return 0;
 }
\ No newline at end of file
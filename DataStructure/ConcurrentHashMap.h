@@ -0,0 +1,319 @@
+#ifndef CONCURRENT_HASH_MAP_H
+#define CONCURRENT_HASH_MAP_H
+
+// 多线程共享的哈希表：分段加锁写、无锁读
+//
+// - 按哈希值的高位把 key 分到若干段，每段一把互斥锁、一张线性探测表，写操作只锁所在的段；
+// - 每张表带一个版本号（seqlock）：写者修改前后各加 1，读者不加锁，读前读后版本号相同
+//   且为偶数时结果有效，否则重试；连续失败几次后改为加锁读，写很多时读者也不会饿死；
+// - 删除时把同一簇后面的记录前移（与 HashTable.cpp 相同），没有墓碑；
+// - 扩容只锁当前段：在新表中建好后用一次原子写替换表指针，读者继续读旧表（旧表已不再修改，
+//   读到的是替换前一刻的一致内容），不需要等待扩容完成。
+//   旧表可能还有读者在用，挂在段上直到析构才释放，多占的内存不超过当前表的大小。
+//
+// 读者会读到正在被修改的槽位（之后通过版本号丢弃），所以 K、V 必须可以按字节复制，
+// 查找通过复制返回 value。需要原地修改 value 时用 update()，回调在段锁内执行。
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "FlatHashMap.h"
+
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K> >
+class concurrent_hash_map {
+	static_assert(std::is_trivially_copyable<K>::value, "concurrent_hash_map key must be trivially copyable");
+	static_assert(std::is_trivially_copyable<V>::value, "concurrent_hash_map value must be trivially copyable");
+	static const int kOptimisticTries = 8;
+	static const size_t kMinCapacity = 16;
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef size_t size_type;
+
+	// segments 向上取为 2 的幂，最多 65536；capacity 为预计的元素总数
+	explicit concurrent_hash_map(size_t segments = 64, size_t capacity = 0) : hash_(), eq_() {
+		size_t n = 1;
+		while (n < segments && n < 65536) n <<= 1;
+		seg_mask_ = n - 1;
+		segments_ = new segment[n];
+		size_t per = kMinCapacity;
+		while (per * 3 / 4 < capacity / n + 1) per <<= 1;
+		for (size_t i = 0; i < n; ++i) segments_[i].current.store(make_table(per), std::memory_order_relaxed);
+	}
+	~concurrent_hash_map() {
+		for (size_t i = 0; i <= seg_mask_; ++i) {
+			free_table(segments_[i].current.load(std::memory_order_relaxed));
+			for (size_t j = 0; j < segments_[i].retired.size(); ++j) free_table(segments_[i].retired[j]);
+		}
+		delete[] segments_;
+	}
+	concurrent_hash_map(const concurrent_hash_map &) = delete;
+	concurrent_hash_map &operator=(const concurrent_hash_map &) = delete;
+
+	// 找到时把 value 复制到 out
+	bool find(const K &key, V &out) const {
+		size_t h = hash_of(key);
+		segment &seg = segment_of(h);
+		for (int tries = 0; tries < kOptimisticTries; ++tries) {
+			const table *t = seg.current.load(std::memory_order_acquire);
+			unsigned seq = t->seq.load(std::memory_order_acquire);
+			if (seq & 1) {
+				cpu_relax();
+				continue;
+			}
+			V value;
+			bool found = read_slot(t, h, key, &value);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (t->seq.load(std::memory_order_relaxed) == seq) {
+				if (found) out = value;
+				return found;
+			}
+		}
+		std::lock_guard<std::mutex> guard(seg.lock);
+		const table *t = seg.current.load(std::memory_order_relaxed);
+		size_t i;
+		if (!locate(t, h, key, &i)) return false;
+		out = t->slots[i].value;
+		return true;
+	}
+	bool contains(const K &key) const {
+		V value;
+		return find(key, value);
+	}
+
+	// key 已存在时不修改，返回 false
+	bool insert(const K &key, const V &value) {
+		size_t h = hash_of(key);
+		segment &seg = segment_of(h);
+		std::lock_guard<std::mutex> guard(seg.lock);
+		size_t i;
+		if (locate(seg.current.load(std::memory_order_relaxed), h, key, &i)) return false;
+		insert_new(seg, h, key, value);
+		return true;
+	}
+	// key 已存在时覆盖 value，返回是否新插入
+	bool insert_or_assign(const K &key, const V &value) {
+		size_t h = hash_of(key);
+		segment &seg = segment_of(h);
+		std::lock_guard<std::mutex> guard(seg.lock);
+		table *t = seg.current.load(std::memory_order_relaxed);
+		size_t i;
+		if (locate(t, h, key, &i)) {
+			write_begin(t);
+			t->slots[i].value = value;
+			write_end(t);
+			return false;
+		}
+		insert_new(seg, h, key, value);
+		return true;
+	}
+	// 在段锁内调用 f(V &) 修改 value，key 不存在时返回 false
+	template <class F>
+	bool update(const K &key, F f) {
+		size_t h = hash_of(key);
+		segment &seg = segment_of(h);
+		std::lock_guard<std::mutex> guard(seg.lock);
+		table *t = seg.current.load(std::memory_order_relaxed);
+		size_t i;
+		if (!locate(t, h, key, &i)) return false;
+		V value = t->slots[i].value;
+		f(value);
+		write_begin(t);
+		t->slots[i].value = value;
+		write_end(t);
+		return true;
+	}
+
+	bool erase(const K &key) {
+		size_t h = hash_of(key);
+		segment &seg = segment_of(h);
+		std::lock_guard<std::mutex> guard(seg.lock);
+		table *t = seg.current.load(std::memory_order_relaxed);
+		size_t i;
+		if (!locate(t, h, key, &i)) return false;
+		write_begin(t);
+		erase_slot(t, i);
+		write_end(t);
+		seg.count.store(seg.count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// 并发修改时只是一个近似值
+	size_t size() const {
+		size_t n = 0;
+		for (size_t i = 0; i <= seg_mask_; ++i) n += segments_[i].count.load(std::memory_order_relaxed);
+		return n;
+	}
+	bool empty() const { return size() == 0; }
+	size_t segment_count() const { return seg_mask_ + 1; }
+	size_t capacity() const {
+		size_t n = 0;
+		for (size_t i = 0; i <= seg_mask_; ++i) n += segments_[i].current.load(std::memory_order_relaxed)->mask + 1;
+		return n;
+	}
+
+	// 逐段清空，保留容量
+	void clear() {
+		for (size_t s = 0; s <= seg_mask_; ++s) {
+			segment &seg = segments_[s];
+			std::lock_guard<std::mutex> guard(seg.lock);
+			table *t = seg.current.load(std::memory_order_relaxed);
+			write_begin(t);
+			for (size_t i = 0; i <= t->mask; ++i) store_hash(t, i, 0);
+			write_end(t);
+			seg.count.store(0, std::memory_order_relaxed);
+		}
+	}
+
+private:
+	// hash 为 0 表示空槽位
+	struct slot {
+		size_t hash;
+		K key;
+		V value;
+	};
+	struct table {
+		std::atomic<unsigned> seq;		// 奇数表示正在修改
+		size_t mask;
+		slot *slots;
+	};
+	// 段尾补一个缓存行，相邻两段的锁和表指针不在同一缓存行上，不同段的写者之间没有伪共享
+	struct segment {
+		segment() : current(NULL), count(0) { }
+		std::mutex lock;
+		std::atomic<table *> current;
+		std::atomic<size_t> count;
+		std::vector<table *> retired;	// 被替换的旧表，只在段锁内访问
+		char pad[64];
+	};
+
+	static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	size_t hash_of(const K &key) const {
+		size_t h = flat_hash_detail::apply_hash<Hash>(hash_(key));
+		return h ? h : 1;
+	}
+	// 段号取高位，表内位置取低位
+	segment &segment_of(size_t h) const { return segments_[(h >> 32) & seg_mask_]; }
+
+	static table *make_table(size_t capacity) {
+		table *t = new table;
+		t->seq.store(0, std::memory_order_relaxed);
+		t->mask = capacity - 1;
+		t->slots = static_cast<slot *>(::operator new(sizeof(slot) * capacity));
+		for (size_t i = 0; i < capacity; ++i) t->slots[i].hash = 0;
+		return t;
+	}
+	static void free_table(table *t) {
+		::operator delete(t->slots);
+		delete t;
+	}
+
+	static size_t load_hash(const table *t, size_t i) { return __atomic_load_n(&t->slots[i].hash, __ATOMIC_RELAXED); }
+	static void store_hash(table *t, size_t i, size_t h) { __atomic_store_n(&t->slots[i].hash, h, __ATOMIC_RELAXED); }
+
+	static void write_begin(table *t) {
+		t->seq.store(t->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	static void write_end(table *t) { t->seq.store(t->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	// 无锁读：先把 key、value 复制出来再比较，读到的可能是写了一半的内容，由调用方检查版本号；
+	// 最多探测整张表，内容错乱时也不会死循环
+	bool read_slot(const table *t, size_t h, const K &key, V *out) const {
+		for (size_t i = h & t->mask, n = 0; n <= t->mask; i = (i + 1) & t->mask, ++n) {
+			size_t sh = load_hash(t, i);
+			if (sh == 0) return false;
+			if (sh != h) continue;
+			typename std::aligned_storage<sizeof(K), alignof(K)>::type buf;
+			memcpy(&buf, &t->slots[i].key, sizeof(K));
+			if (eq_(*reinterpret_cast<const K *>(&buf), key)) {
+				memcpy(static_cast<void *>(out), &t->slots[i].value, sizeof(V));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 持锁查找：找到时 i 为记录位置，否则为可以插入的空位置
+	bool locate(const table *t, size_t h, const K &key, size_t *i) const {
+		size_t p = h & t->mask;
+		for (;;) {
+			size_t sh = t->slots[p].hash;
+			if (sh == 0) break;
+			if (sh == h && eq_(t->slots[p].key, key)) {
+				*i = p;
+				return true;
+			}
+			p = (p + 1) & t->mask;
+		}
+		*i = p;
+		return false;
+	}
+
+	// 已知 key 不存在；负载因子超过 3/4 时先扩容
+	void insert_new(segment &seg, size_t h, const K &key, const V &value) {
+		table *t = seg.current.load(std::memory_order_relaxed);
+		size_t count = seg.count.load(std::memory_order_relaxed);
+		if ((count + 1) * 4 > (t->mask + 1) * 3) t = grow(seg, t);
+		size_t i = h & t->mask;
+		while (t->slots[i].hash) i = (i + 1) & t->mask;
+		write_begin(t);
+		t->slots[i].key = key;
+		t->slots[i].value = value;
+		store_hash(t, i, h);
+		write_end(t);
+		seg.count.store(count + 1, std::memory_order_relaxed);
+	}
+
+	// 新表对读者不可见时在里面建好，最后一次原子写发布；旧表不再修改
+	table *grow(segment &seg, table *old) {
+		table *t = make_table((old->mask + 1) * 2);
+		for (size_t i = 0; i <= old->mask; ++i) {
+			size_t h = old->slots[i].hash;
+			if (!h) continue;
+			size_t j = h & t->mask;
+			while (t->slots[j].hash) j = (j + 1) & t->mask;
+			t->slots[j] = old->slots[i];
+		}
+		seg.current.store(t, std::memory_order_release);
+		seg.retired.push_back(old);
+		return t;
+	}
+
+	// 后移删除：j 上的记录的起始位置不在循环区间 (i, j] 内时，可以前移到空位 i
+	static void erase_slot(table *t, size_t i) {
+		size_t j = i;
+		for (;;) {
+			j = (j + 1) & t->mask;
+			size_t h = t->slots[j].hash;
+			if (!h) break;
+			size_t home = h & t->mask;
+			if (((j - home) & t->mask) >= ((j - i) & t->mask)) {
+				t->slots[i].key = t->slots[j].key;
+				t->slots[i].value = t->slots[j].value;
+				store_hash(t, i, h);
+				i = j;
+			}
+		}
+		store_hash(t, i, 0);
+	}
+
+	segment *segments_;
+	size_t seg_mask_;
+	Hash hash_;
+	Eq eq_;
+};
+
+#endif
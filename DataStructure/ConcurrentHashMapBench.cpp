@@ -0,0 +1,121 @@
+// concurrent_hash_map 的多线程吞吐测试，对比一把全局 std::mutex 保护的 flat_hash_map
+//
+// key 空间为 2 * N，预先插入其中一半；每个线程按给定比例随机执行查找 / 插入 / 删除，
+// 插入和删除各占写操作的一半，所以元素个数大致不变。输出所有线程合计的每秒操作数（百万）。
+// 读多写少：95% 查找；写多：50% 查找。
+//
+// 编译：g++ -std=c++11 -O2 ConcurrentHashMapBench.cpp -o ConcurrentHashMapBench -pthread
+// 用法：./ConcurrentHashMapBench [线程数,...] [N] [每线程操作数]
+//       默认 1,2,4,8 1000000 2000000
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentHashMap.h"
+#include "FlatHashMap.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// 全局锁基准
+class locked_map {
+public:
+	bool find(uint64_t key, uint64_t &out) {
+		std::lock_guard<std::mutex> guard(lock_);
+		flat_hash_map<uint64_t, uint64_t>::iterator it = map_.find(key);
+		if (it == map_.end()) return false;
+		out = it->second;
+		return true;
+	}
+	bool insert(uint64_t key, uint64_t value) {
+		std::lock_guard<std::mutex> guard(lock_);
+		return map_.insert(std::make_pair(key, value)).second;
+	}
+	bool erase(uint64_t key) {
+		std::lock_guard<std::mutex> guard(lock_);
+		return map_.erase(key) != 0;
+	}
+private:
+	std::mutex lock_;
+	flat_hash_map<uint64_t, uint64_t> map_;
+};
+
+struct options {
+	size_t keys;			// key 空间大小
+	size_t ops;				// 每个线程的操作数
+	unsigned read_percent;
+};
+
+template <class Map>
+static void worker(Map *map, const options *opt, uint64_t seed, uint64_t *checksum) {
+	uint64_t state = seed, sum = 0, value;
+	for (size_t i = 0; i < opt->ops; ++i) {
+		uint64_t r = splitmix64(state);
+		uint64_t key = (r >> 8) % opt->keys;
+		unsigned dice = static_cast<unsigned>(r & 0xff) * 100 / 256;
+		if (dice < opt->read_percent) {
+			if (map->find(key, value)) sum += value;
+		} else if (dice & 1) {
+			sum += map->insert(key, key);
+		} else {
+			sum += map->erase(key);
+		}
+	}
+	*checksum = sum;
+}
+
+template <class Map>
+static double run(const options &opt, int threads) {
+	Map *map = new Map();
+	for (size_t k = 0; k < opt.keys; k += 2) map->insert(k, k);
+
+	std::vector<std::thread> pool;
+	std::vector<uint64_t> sums(threads);
+	Clock::time_point start = Clock::now();
+	for (int t = 0; t < threads; ++t)
+		pool.push_back(std::thread(worker<Map>, map, &opt, static_cast<uint64_t>(t + 1) * 7919, &sums[t]));
+	for (int t = 0; t < threads; ++t) pool[t].join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	delete map;
+	return opt.ops * threads / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+	std::vector<int> threads;
+	if (argc > 1) {
+		for (char *tok = strtok(argv[1], ","); tok != NULL; tok = strtok(NULL, ","))
+			threads.push_back(atoi(tok));
+	} else {
+		threads.push_back(1);
+		threads.push_back(2);
+		threads.push_back(4);
+		threads.push_back(8);
+	}
+	options opt;
+	opt.keys = (argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000) * 2;
+	opt.ops = argc > 3 ? strtoull(argv[3], NULL, 10) : 2000000;
+
+	const unsigned mixes[] = { 95, 50 };
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	printf("%-10s %8s %22s %22s\n", "reads", "threads", "concurrent_hash_map", "mutex+flat_hash_map");
+	for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m) {
+		opt.read_percent = mixes[m];
+		for (size_t t = 0; t < threads.size(); ++t) {
+			double a = run<concurrent_hash_map<uint64_t, uint64_t> >(opt, threads[t]);
+			double b = run<locked_map>(opt, threads[t]);
+			printf("%9u%% %8d %17.2f Mop/s %17.2f Mop/s\n", mixes[m], threads[t], a, b);
+		}
+	}
+	return 0;
+}
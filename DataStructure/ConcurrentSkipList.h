@@ -0,0 +1,490 @@
+#ifndef CONCURRENT_SKIP_LIST_H
+#define CONCURRENT_SKIP_LIST_H
+
+// 多线程共享的无锁有序 map：跳表 + 基于 epoch 的内存回收
+//
+// - 红黑树的旋转一次要改多个结点，只能整棵树加锁；跳表每层都是有序单链表，
+//   插入、删除都是若干次单指针 CAS，查找、范围扫描完全不加锁，可以与写操作同时进行；
+// - 删除按 Harris 链表的做法分两步：先在结点各层的 next 指针最低位打删除标记（逻辑删除），
+//   再由删除者或之后路过的线程用 CAS 把它从链表中摘掉（物理删除）；
+//   打了标记的 next 不能再被修改，所以不会有新结点挂到已删除的结点后面；
+// - 摘下的结点可能还有其它线程正在访问，不能马上释放：每个线程访问前在自己的槽位登记当前 epoch，
+//   摘下的结点记录摘下时的 epoch 放进本线程的待回收列表；所有正在访问的线程都进入当前 epoch 后
+//   全局 epoch 加 1，全局 epoch 比结点的 epoch 大 2 时，已没有线程能看到它，可以释放；
+// - 接口与 RBMap.h 中 rb_map 相同的部分：find / lower_bound / upper_bound / begin / end、
+//   insert / try_emplace / erase / size，迭代器只能向前。
+//
+// 使用限制：
+// - value 插入后不可修改（没有 operator[]），需要更新时先 erase 再 insert；
+// - 返回的迭代器指向的结点只在持有 guard 期间保证不被释放：
+//       concurrent_skip_list<K, V>::guard g(list);
+//       for (it = list.lower_bound(a); it != list.end() && it->first < b; ++it) ...
+//   遍历看到的是各个结点被访问时的状态（不是某一时刻的快照）；
+//   不需要迭代器时用 find(key, out) / scan(lo, hi, f)，它们自己进入和退出 guard；
+// - 同时访问的线程最多 kMaxThreads 个（线程退出后编号可以复用），clear / 析构时不能有其它线程访问。
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace skip_list_detail {
+
+static const int kMaxThreads = 256;
+
+// 线程编号：首次使用时分配最小的空闲编号，线程退出时归还
+class thread_slots {
+public:
+	static int id() {
+		thread_local holder h;
+		return h.id;
+	}
+	// 分配过的最大编号 + 1，推进 epoch 时只需要检查这些槽位
+	static int high_water() { return high_water_ref().load(std::memory_order_acquire); }
+private:
+	struct holder {
+		holder() : id(acquire()) { }
+		~holder() { used()[id].store(false, std::memory_order_release); }
+		int id;
+	};
+	static std::atomic<bool> *used() {
+		static std::atomic<bool> slots[kMaxThreads];
+		return slots;
+	}
+	static std::atomic<int> &high_water_ref() {
+		static std::atomic<int> n(0);
+		return n;
+	}
+	static int acquire() {
+		for (;;) {
+			for (int i = 0; i < kMaxThreads; ++i) {
+				bool expected = false;
+				if (!used()[i].load(std::memory_order_relaxed) &&
+					used()[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					int hw = high_water_ref().load(std::memory_order_relaxed);
+					while (hw < i + 1 && !high_water_ref().compare_exchange_weak(hw, i + 1)) { }
+					return i;
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+};
+
+// 基于 epoch 的回收，每个 epoch_domain 管理一种对象
+class epoch_domain {
+	static const unsigned kScanInterval = 64;
+public:
+	typedef void (*deleter)(void *);
+
+	explicit epoch_domain(deleter del) : del_(del), epoch_(2), slots_(new slot[kMaxThreads]) { }
+	~epoch_domain() {
+		for (int i = 0; i < kMaxThreads; ++i)
+			for (size_t j = 0; j < slots_[i].limbo.size(); ++j) del_(slots_[i].limbo[j].ptr);
+		delete[] slots_;
+	}
+	epoch_domain(const epoch_domain &) = delete;
+	epoch_domain &operator=(const epoch_domain &) = delete;
+
+	// 进入 / 退出临界区，可以嵌套
+	void enter() {
+		slot &s = slots_[thread_slots::id()];
+		if (s.nesting++ == 0) {
+			s.state.store((epoch_.load(std::memory_order_relaxed) << 1) | 1, std::memory_order_relaxed);
+			// 登记必须在之后读取任何共享指针之前对其它线程可见
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+	void exit() {
+		slot &s = slots_[thread_slots::id()];
+		if (--s.nesting == 0) s.state.store(0, std::memory_order_release);
+	}
+
+	// p 已经从数据结构中摘下，等没有线程能访问到时再释放
+	void retire(void *p) {
+		slot &s = slots_[thread_slots::id()];
+		retired r = { p, epoch_.load(std::memory_order_acquire) };
+		s.limbo.push_back(r);
+		if (++s.retires >= kScanInterval) {
+			s.retires = 0;
+			try_advance();
+			reclaim(s);
+		}
+	}
+
+	// 没有其它线程访问时释放全部待回收对象
+	void drain() {
+		for (int i = 0; i < kMaxThreads; ++i) {
+			for (size_t j = 0; j < slots_[i].limbo.size(); ++j) del_(slots_[i].limbo[j].ptr);
+			slots_[i].limbo.clear();
+		}
+	}
+
+private:
+	struct retired {
+		void *ptr;
+		uint64_t epoch;
+	};
+	struct slot {
+		slot() : state(0), nesting(0), retires(0) { }
+		std::atomic<uint64_t> state;	// 0 表示不在临界区，否则为 (进入时的 epoch << 1) | 1
+		unsigned nesting;
+		unsigned retires;
+		std::vector<retired> limbo;		// 只有本线程访问
+		char pad[64];
+	};
+
+	// 所有在临界区中的线程都已进入当前 epoch 时推进全局 epoch
+	void try_advance() {
+		uint64_t e = epoch_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int n = thread_slots::high_water();
+		for (int i = 0; i < n; ++i) {
+			uint64_t st = slots_[i].state.load(std::memory_order_acquire);
+			if ((st & 1) && (st >> 1) != e) return;
+		}
+		epoch_.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+	}
+
+	void reclaim(slot &s) {
+		uint64_t e = epoch_.load(std::memory_order_acquire);
+		size_t keep = 0;
+		for (size_t i = 0; i < s.limbo.size(); ++i) {
+			if (s.limbo[i].epoch + 2 <= e) del_(s.limbo[i].ptr);
+			else s.limbo[keep++] = s.limbo[i];
+		}
+		s.limbo.resize(keep);
+	}
+
+	deleter del_;
+	std::atomic<uint64_t> epoch_;
+	char pad_[64];
+	slot *slots_;
+};
+
+}  // namespace skip_list_detail
+
+template <class K, class V, class Compare = std::less<K> >
+class concurrent_skip_list {
+	static const int kMaxLevel = 24;	// 每层保留 1/4，足够 2^48 个元素
+
+	struct node {
+		std::pair<const K, V> value;
+		int height;
+		// 插入者完成各层链接、删除者完成摘除各减 1，减到 0 的一方负责交给 epoch 回收，
+		// 避免插入者在删除完成后又把结点挂到某个上层
+		std::atomic<int> pending;
+		std::atomic<uintptr_t> next[1];		// 实际长度为 height，最低位为删除标记
+	};
+
+	static node *ptr(uintptr_t v) { return reinterpret_cast<node *>(v & ~static_cast<uintptr_t>(1)); }
+	static bool marked(uintptr_t v) { return v & 1; }
+	static uintptr_t word(node *n) { return reinterpret_cast<uintptr_t>(n); }
+
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef Compare key_compare;
+	typedef size_t size_type;
+
+	// 作用域内本线程处于 epoch 临界区，期间读到的结点不会被释放
+	class guard {
+	public:
+		explicit guard(const concurrent_skip_list &list) : domain_(list.domain_) { domain_.enter(); }
+		~guard() { domain_.exit(); }
+		guard(const guard &) = delete;
+		guard &operator=(const guard &) = delete;
+	private:
+		skip_list_detail::epoch_domain &domain_;
+	};
+
+	// 只读的前向迭代器，跳过已被逻辑删除的结点
+	class const_iterator {
+		friend class concurrent_skip_list;
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef std::pair<const K, V> value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const value_type *pointer;
+		typedef const value_type &reference;
+
+		const_iterator() : node_(NULL) { }
+		reference operator*() const { return node_->value; }
+		pointer operator->() const { return &node_->value; }
+		const_iterator &operator++() {
+			node_ = live(ptr(node_->next[0].load(std::memory_order_acquire)));
+			return *this;
+		}
+		const_iterator operator++(int) { const_iterator tmp = *this; ++*this; return tmp; }
+		bool operator==(const const_iterator &other) const { return node_ == other.node_; }
+		bool operator!=(const const_iterator &other) const { return node_ != other.node_; }
+	private:
+		explicit const_iterator(node *n) : node_(n) { }
+		node *node_;
+	};
+	typedef const_iterator iterator;
+
+	explicit concurrent_skip_list(const Compare &comp = Compare())
+		: comp_(comp), domain_(&free_node), size_(0) {
+		for (int i = 0; i < kMaxLevel; ++i) head_[i].store(0, std::memory_order_relaxed);
+	}
+	~concurrent_skip_list() { clear(); }
+	concurrent_skip_list(const concurrent_skip_list &) = delete;
+	concurrent_skip_list &operator=(const concurrent_skip_list &) = delete;
+
+	const_iterator begin() const {
+		guard g(*this);
+		return const_iterator(live(ptr(head_[0].load(std::memory_order_acquire))));
+	}
+	const_iterator end() const { return const_iterator(); }
+
+	// 并发修改时只是近似值
+	size_t size() const { return size_.load(std::memory_order_relaxed); }
+	bool empty() const { return begin() == end(); }
+
+	const_iterator find(const K &key) const {
+		guard g(*this);
+		node *n = lower_bound_node(key);
+		return const_iterator(n && !comp_(key, n->value.first) ? n : NULL);
+	}
+	// 找到时把 value 复制到 out
+	bool find(const K &key, V &out) const {
+		guard g(*this);
+		node *n = lower_bound_node(key);
+		if (!n || comp_(key, n->value.first)) return false;
+		out = n->value.second;
+		return true;
+	}
+	size_t count(const K &key) const { return contains(key); }
+	bool contains(const K &key) const { return find(key) != end(); }
+
+	// 第一个不小于 key 的元素
+	const_iterator lower_bound(const K &key) const {
+		guard g(*this);
+		return const_iterator(lower_bound_node(key));
+	}
+	// 第一个大于 key 的元素
+	const_iterator upper_bound(const K &key) const {
+		guard g(*this);
+		const_iterator it(lower_bound_node(key));
+		if (it != end() && !comp_(key, it->first)) ++it;
+		return it;
+	}
+
+	// 按顺序对 [lo, hi) 中的每个元素调用 f(key, value)，f 返回 false 时提前结束；返回访问的元素个数
+	template <class F>
+	size_t scan(const K &lo, const K &hi, F f) const {
+		guard g(*this);
+		size_t n = 0;
+		for (const_iterator it(lower_bound_node(lo)); it != end() && comp_(it->first, hi); ++it) {
+			++n;
+			if (!f(it->first, it->second)) break;
+		}
+		return n;
+	}
+
+	std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+
+	// key 已存在时不构造 value，返回已有的元素
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(const K &key, Args &&... args) {
+		guard g(*this);
+		std::atomic<uintptr_t> *preds[kMaxLevel];
+		node *succs[kMaxLevel];
+		node *n = NULL;
+		for (;;) {
+			if (search(key, preds, succs)) {
+				if (n) destroy_node(n);
+				return std::make_pair(iterator(succs[0]), false);
+			}
+			if (!n) n = create(random_level(), key, std::forward<Args>(args)...);
+			for (int i = 0; i < n->height; ++i) n->next[i].store(word(succs[i]), std::memory_order_relaxed);
+			uintptr_t expected = word(succs[0]);
+			// 挂到第 0 层即插入成功
+			if (preds[0]->compare_exchange_strong(expected, word(n), std::memory_order_release)) break;
+		}
+		size_.fetch_add(1, std::memory_order_relaxed);
+		link_upper(n, preds, succs);
+		return std::make_pair(iterator(n), true);
+	}
+
+	size_t erase(const K &key) {
+		guard g(*this);
+		std::atomic<uintptr_t> *preds[kMaxLevel];
+		node *succs[kMaxLevel];
+		if (!search(key, preds, succs)) return 0;
+		return remove(succs[0], preds, succs);
+	}
+	// 删除 pos 指向的结点本身（而不是按 key 删除：其它线程可能已经删掉它又插入了同一个 key），
+	// 该结点已被删除时什么也不做。返回下一个元素的迭代器，调用者需持有 guard
+	iterator erase(const_iterator pos) {
+		const_iterator next = pos;
+		++next;
+		std::atomic<uintptr_t> *preds[kMaxLevel];
+		node *succs[kMaxLevel];
+		remove(pos.node_, preds, succs);
+		return next;
+	}
+
+	// 不能与其它线程的访问同时进行
+	void clear() {
+		node *n = ptr(head_[0].load(std::memory_order_relaxed));
+		while (n) {
+			node *next = ptr(n->next[0].load(std::memory_order_relaxed));
+			destroy_node(n);
+			n = next;
+		}
+		for (int i = 0; i < kMaxLevel; ++i) head_[i].store(0, std::memory_order_relaxed);
+		size_.store(0, std::memory_order_relaxed);
+		domain_.drain();
+	}
+
+	key_compare key_comp() const { return comp_; }
+
+private:
+	template <class... Args>
+	static node *create(int height, const K &key, Args &&... args) {
+		void *mem = ::operator new(sizeof(node) + (height - 1) * sizeof(std::atomic<uintptr_t>));
+		node *n = static_cast<node *>(mem);
+		try {
+			new (const_cast<std::pair<const K, V> *>(&n->value)) std::pair<const K, V>(
+				std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		} catch (...) {
+			::operator delete(mem);
+			throw;
+		}
+		n->height = height;
+		new (&n->pending) std::atomic<int>(2);
+		for (int i = 0; i < height; ++i) new (&n->next[i]) std::atomic<uintptr_t>(0);
+		return n;
+	}
+	static void destroy_node(node *n) {
+		n->value.~pair();
+		::operator delete(n);
+	}
+	static void free_node(void *p) { destroy_node(static_cast<node *>(p)); }
+
+	void release(node *n) {
+		if (n->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) domain_.retire(n);
+	}
+
+	// 从上到下打删除标记，第 0 层标记成功的线程完成删除：再查找一次，顺路摘掉各层中的该结点。
+	// preds / succs 只是 search 的工作区
+	size_t remove(node *n, std::atomic<uintptr_t> **preds, node **succs) {
+		for (int i = n->height - 1; i > 0; --i) {
+			uintptr_t v = n->next[i].load(std::memory_order_acquire);
+			while (!marked(v) && !n->next[i].compare_exchange_weak(v, v | 1, std::memory_order_acq_rel)) { }
+		}
+		uintptr_t v = n->next[0].load(std::memory_order_acquire);
+		for (;;) {
+			if (marked(v)) return 0;
+			if (n->next[0].compare_exchange_weak(v, v | 1, std::memory_order_acq_rel)) break;
+		}
+		size_.fetch_sub(1, std::memory_order_relaxed);
+		search(n->value.first, preds, succs);
+		release(n);
+		return 1;
+	}
+
+	// 从 n 开始第一个未被逻辑删除的结点
+	static node *live(node *n) {
+		while (n) {
+			uintptr_t v = n->next[0].load(std::memory_order_acquire);
+			if (!marked(v)) return n;
+			n = ptr(v);
+		}
+		return NULL;
+	}
+
+	// 只读查找：第 0 层第一个不小于 key 且未删除的结点，不修改链表
+	node *lower_bound_node(const K &key) const {
+		node *pred = NULL, *curr = NULL;
+		for (int level = kMaxLevel - 1; level >= 0; --level) {
+			curr = ptr((pred ? &pred->next[level] : &head_[level])->load(std::memory_order_acquire));
+			while (curr) {
+				uintptr_t next = curr->next[level].load(std::memory_order_acquire);
+				if (!marked(next)) {
+					if (!comp_(curr->value.first, key)) break;
+					pred = curr;
+				}
+				curr = ptr(next);
+			}
+		}
+		return curr;
+	}
+
+	// 查找 key 在每一层的前驱（指向要修改的 next 指针）和后继，路过打了删除标记的结点时把它摘掉；
+	// 第 0 层的后继等于 key 时返回 true
+	bool search(const K &key, std::atomic<uintptr_t> **preds, node **succs) {
+	retry:
+		node *pred = NULL;
+		for (int level = kMaxLevel - 1; level >= 0; --level) {
+			std::atomic<uintptr_t> *prev = pred ? &pred->next[level] : &head_[level];
+			uintptr_t pv = prev->load(std::memory_order_acquire);
+			if (marked(pv)) goto retry;		// 前驱刚被删除
+			node *curr = ptr(pv);
+			while (curr) {
+				uintptr_t next = curr->next[level].load(std::memory_order_acquire);
+				if (marked(next)) {
+					uintptr_t expected = word(curr);
+					if (!prev->compare_exchange_strong(expected, word(ptr(next)), std::memory_order_acq_rel))
+						goto retry;
+					curr = ptr(next);
+					continue;
+				}
+				if (!comp_(curr->value.first, key)) break;
+				pred = curr;
+				prev = &curr->next[level];
+				curr = ptr(next);
+			}
+			preds[level] = prev;
+			succs[level] = curr;
+		}
+		return succs[0] && !comp_(key, succs[0]->value.first);
+	}
+
+	// 第 0 层已经挂上后，逐层挂上更高的层；结点被删除（next 带标记）时停止
+	void link_upper(node *n, std::atomic<uintptr_t> **preds, node **succs) {
+		for (int level = 1; level < n->height; ++level) {
+			for (;;) {
+				uintptr_t v = n->next[level].load(std::memory_order_acquire);
+				if (marked(v)) goto done;
+				if (ptr(v) != succs[level] &&
+					!n->next[level].compare_exchange_strong(v, word(succs[level]), std::memory_order_acq_rel))
+					goto done;
+				uintptr_t expected = word(succs[level]);
+				if (preds[level]->compare_exchange_strong(expected, word(n), std::memory_order_release)) break;
+				// 前驱变了，重新查找；结点已被删除时 search 找不到它，也停止
+				if (!search(n->value.first, preds, succs) || succs[0] != n) goto done;
+			}
+		}
+	done:
+		// 链接期间结点被删除时，删除者的查找可能没有摘掉后来挂上的层，再摘一次
+		if (marked(n->next[0].load(std::memory_order_acquire))) search(n->value.first, preds, succs);
+		release(n);
+	}
+
+	// 层数按 1/4 的概率逐层增加
+	static int random_level() {
+		thread_local uint64_t state = 0x9E3779B97F4A7C15ULL ^ reinterpret_cast<uintptr_t>(&state);
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		int level = 1 + __builtin_ctzll(state | (1ULL << 62)) / 2;
+		return level < kMaxLevel ? level : kMaxLevel;
+	}
+
+	Compare comp_;
+	mutable skip_list_detail::epoch_domain domain_;
+	std::atomic<uintptr_t> head_[kMaxLevel];
+	std::atomic<size_t> size_;
+};
+
+#endif
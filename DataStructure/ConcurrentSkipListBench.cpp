@@ -0,0 +1,148 @@
+// concurrent_skip_list 的多线程扩展性测试，对比一把全局 std::mutex 保护的 rb_map
+//
+// key 空间为 2 * N，预先插入其中一半；每个线程按给定比例随机执行查找 / 范围扫描 / 插入 / 删除，
+// 插入和删除各占写操作的一半，所以元素个数大致不变。范围扫描从随机 key 开始顺序读 100 个元素。
+// 输出所有线程合计的每秒操作数（百万）。
+// 读多写少：95% 查找、5% 写；扫描与写并发：60% 查找、20% 扫描、20% 写。
+//
+// 编译：g++ -std=c++11 -O2 ConcurrentSkipListBench.cpp -o ConcurrentSkipListBench -pthread
+// 用法：./ConcurrentSkipListBench [线程数,...] [N] [每线程操作数]
+//       默认 1,2,4,8,16,32,64 1000000 500000
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentSkipList.h"
+#include "RBMap.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kScanLength = 100;
+
+static uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+class skip_list_map {
+public:
+	bool find(uint64_t key, uint64_t &out) { return list_.find(key, out); }
+	uint64_t scan(uint64_t key) {
+		uint64_t sum = 0;
+		concurrent_skip_list<uint64_t, uint64_t>::guard g(list_);
+		concurrent_skip_list<uint64_t, uint64_t>::const_iterator it = list_.lower_bound(key);
+		for (size_t j = 0; j < kScanLength && it != list_.end(); ++j, ++it) sum += it->second;
+		return sum;
+	}
+	bool insert(uint64_t key, uint64_t value) { return list_.insert(std::make_pair(key, value)).second; }
+	bool erase(uint64_t key) { return list_.erase(key) != 0; }
+private:
+	concurrent_skip_list<uint64_t, uint64_t> list_;
+};
+
+// 全局锁基准
+class locked_map {
+public:
+	bool find(uint64_t key, uint64_t &out) {
+		std::lock_guard<std::mutex> guard(lock_);
+		rb_map<uint64_t, uint64_t>::iterator it = map_.find(key);
+		if (it == map_.end()) return false;
+		out = it->second;
+		return true;
+	}
+	uint64_t scan(uint64_t key) {
+		uint64_t sum = 0;
+		std::lock_guard<std::mutex> guard(lock_);
+		rb_map<uint64_t, uint64_t>::const_iterator it = map_.lower_bound(key);
+		for (size_t j = 0; j < kScanLength && it != map_.end(); ++j, ++it) sum += it->second;
+		return sum;
+	}
+	bool insert(uint64_t key, uint64_t value) {
+		std::lock_guard<std::mutex> guard(lock_);
+		return map_.insert(std::make_pair(key, value)).second;
+	}
+	bool erase(uint64_t key) {
+		std::lock_guard<std::mutex> guard(lock_);
+		return map_.erase(key) != 0;
+	}
+private:
+	std::mutex lock_;
+	rb_map<uint64_t, uint64_t> map_;
+};
+
+struct options {
+	size_t keys;			// key 空间大小
+	size_t ops;				// 每个线程的操作数
+	unsigned read_percent;
+	unsigned scan_percent;
+};
+
+template <class Map>
+static void worker(Map *map, const options *opt, uint64_t seed, uint64_t *checksum) {
+	uint64_t state = seed, sum = 0, value;
+	for (size_t i = 0; i < opt->ops; ++i) {
+		uint64_t r = splitmix64(state);
+		uint64_t key = (r >> 8) % opt->keys;
+		unsigned dice = static_cast<unsigned>(r & 0xff) * 100 / 256;
+		if (dice < opt->read_percent) {
+			if (map->find(key, value)) sum += value;
+		} else if (dice < opt->read_percent + opt->scan_percent) {
+			sum += map->scan(key);
+		} else if (dice & 1) {
+			sum += map->insert(key, key);
+		} else {
+			sum += map->erase(key);
+		}
+	}
+	*checksum = sum;
+}
+
+template <class Map>
+static double run(const options &opt, int threads) {
+	Map *map = new Map();
+	for (size_t k = 0; k < opt.keys; k += 2) map->insert(k, k);
+
+	std::vector<std::thread> pool;
+	std::vector<uint64_t> sums(threads);
+	Clock::time_point start = Clock::now();
+	for (int t = 0; t < threads; ++t)
+		pool.push_back(std::thread(worker<Map>, map, &opt, static_cast<uint64_t>(t + 1) * 7919, &sums[t]));
+	for (int t = 0; t < threads; ++t) pool[t].join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	delete map;
+	return opt.ops * threads / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+	std::vector<int> threads;
+	if (argc > 1) {
+		for (char *tok = strtok(argv[1], ","); tok != NULL; tok = strtok(NULL, ","))
+			threads.push_back(atoi(tok));
+	} else {
+		for (int t = 1; t <= 64; t *= 2) threads.push_back(t);
+	}
+	options opt;
+	opt.keys = (argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000) * 2;
+	opt.ops = argc > 3 ? strtoull(argv[3], NULL, 10) : 500000;
+
+	const unsigned mixes[][2] = { { 95, 0 }, { 60, 20 } };
+	printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	printf("%-14s %8s %22s %22s\n", "find/scan", "threads", "concurrent_skip_list", "mutex+rb_map");
+	for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m) {
+		opt.read_percent = mixes[m][0];
+		opt.scan_percent = mixes[m][1];
+		for (size_t t = 0; t < threads.size(); ++t) {
+			double a = run<skip_list_map>(opt, threads[t]);
+			double b = run<locked_map>(opt, threads[t]);
+			printf("%6u%%/%5u%% %8d %17.2f Mop/s %17.2f Mop/s\n", mixes[m][0], mixes[m][1], threads[t], a, b);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,455 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+// 开放寻址哈希表（SwissTable 布局）
+//
+// - 每个槽位对应一个控制字节：空 0x80、已删除 0xFE、有元素时为哈希值的低 7 位（h2）；
+// - 查找时一次取 16 个控制字节（SSE2，一组），用一条比较指令同时匹配 h2，
+//   只有 h2 相同的槽位才比较 key；组内出现空槽位说明 key 不存在；
+// - 哈希值的其余位（h1）决定起始位置，按组做二次探测；容量为 2 的幂，用掩码代替取模；
+// - 负载因子上限 7/8，超过后容量翻倍，没有上限；删除时能标记为空就不留墓碑。
+// 没有 SSE2 时用 64 位整数一次处理 8 个控制字节。
+// 哈希函数可以换成 Hashers.h 中的 wy_hash 等；默认的 std::hash 结果会先打散。
+//
+// 元素类型为 std::pair<K, V>，不要通过迭代器修改 key。
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace flat_hash_detail {
+
+typedef int8_t ctrl_t;
+static const ctrl_t kEmpty = -128;		// 0b10000000
+static const ctrl_t kDeleted = -2;		// 0b11111110
+
+// 组内匹配结果：每个匹配的槽位对应一个置位的 bit
+class BitMask {
+public:
+	BitMask(uint64_t mask, int shift) : mask_(mask), shift_(shift) { }
+	explicit operator bool() const { return mask_ != 0; }
+	// 最低的匹配位置
+	int lowest() const { return __builtin_ctzll(mask_) >> shift_; }
+	void next() { mask_ &= mask_ - 1; }
+	// 从低位数起连续不匹配的槽位数
+	int trailing_zeros() const { return mask_ ? __builtin_ctzll(mask_) >> shift_ : -1; }
+	int leading_zeros(int width) const {
+		if (!mask_) return -1;
+		int total = 64 - __builtin_clzll(mask_);		// 最高置位 + 1
+		return width - ((total + (1 << shift_) - 1) >> shift_);
+	}
+private:
+	uint64_t mask_;
+	int shift_;
+};
+
+#if defined(__SSE2__)
+struct Group {
+	static const size_t kWidth = 16;
+	explicit Group(const ctrl_t *pos) { ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos)); }
+	BitMask match(int8_t h2) const {
+		return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))), 0);
+	}
+	BitMask match_empty() const { return match(kEmpty); }
+	// 空和已删除的控制字节最高位为 1
+	BitMask match_empty_or_deleted() const { return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl)), 0); }
+	__m128i ctrl;
+};
+#else
+struct Group {
+	static const size_t kWidth = 8;
+	static const uint64_t kLsbs = 0x0101010101010101ULL;
+	static const uint64_t kMsbs = 0x8080808080808080ULL;
+	explicit Group(const ctrl_t *pos) { memcpy(&ctrl, pos, sizeof(ctrl)); }
+	// 可能把 h2 不同的槽位误报为匹配（之后还要比较 key），不会漏报
+	BitMask match(int8_t h2) const {
+		uint64_t x = ctrl ^ (kLsbs * static_cast<uint8_t>(h2));
+		return BitMask((x - kLsbs) & ~x & kMsbs, 3);
+	}
+	// 只有空（0x80）满足最高位为 1 且次高位为 0
+	BitMask match_empty() const { return BitMask(ctrl & (~ctrl << 6) & kMsbs, 3); }
+	BitMask match_empty_or_deleted() const { return BitMask(ctrl & kMsbs, 3); }
+	uint64_t ctrl;
+};
+#endif
+
+// 把 std::hash 的结果打散：整数的 std::hash 是恒等映射，直接拆成 h1/h2 会大量冲突
+inline size_t mix(size_t h) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 r = static_cast<unsigned __int128>(h) * 0x9E3779B97F4A7C15ULL;
+	return static_cast<size_t>(static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64));
+#else
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+#endif
+}
+
+// Hash 中定义了 is_avalanching 类型时认为输出已经充分混合（见 Hashers.h），不再打散
+template <class Hash, class = void>
+struct is_avalanching : std::false_type { };
+template <class Hash>
+struct is_avalanching<Hash, typename std::conditional<true, void, typename Hash::is_avalanching>::type>
+	: std::true_type { };
+
+template <class Hash>
+inline size_t apply_hash(size_t h) {
+	return is_avalanching<Hash>::value ? h : mix(h);
+}
+
+}  // namespace flat_hash_detail
+
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K> >
+class flat_hash_map {
+	typedef flat_hash_detail::ctrl_t ctrl_t;
+	typedef flat_hash_detail::Group Group;
+	static const size_t kWidth = Group::kWidth;
+	static const size_t kBatch = 32;		// 批量操作每次预取的 key 数
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, V> value_type;
+	typedef size_t size_type;
+
+	template <bool Const>
+	class iter {
+		friend class flat_hash_map;
+		typedef typename std::conditional<Const, const flat_hash_map, flat_hash_map>::type map_type;
+	public:
+		typedef typename std::conditional<Const, const value_type, value_type>::type element;
+		iter() : map_(NULL), index_(0) { }
+		// 普通迭代器可以转换为 const 迭代器
+		template <bool OtherConst, class = typename std::enable_if<Const && !OtherConst>::type>
+		iter(const iter<OtherConst> &other) : map_(other.map_), index_(other.index_) { }
+		element &operator*() const { return map_->slots_[index_]; }
+		element *operator->() const { return &map_->slots_[index_]; }
+		iter &operator++() { ++index_; skip(); return *this; }
+		iter operator++(int) { iter tmp = *this; ++*this; return tmp; }
+		bool operator==(const iter &other) const { return index_ == other.index_; }
+		bool operator!=(const iter &other) const { return index_ != other.index_; }
+	private:
+		friend class iter<!Const>;
+		iter(map_type *map, size_t index) : map_(map), index_(index) { skip(); }
+		void skip() {
+			while (index_ < map_->capacity_ && map_->ctrl_[index_] < 0) ++index_;
+		}
+		map_type *map_;
+		size_t index_;
+	};
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+
+	explicit flat_hash_map(size_t bucket_count = 0, const Hash &hash = Hash(), const Eq &eq = Eq())
+		: ctrl_(NULL), slots_(NULL), size_(0), capacity_(0), growth_left_(0), hash_(hash), eq_(eq) {
+		if (bucket_count) reserve(bucket_count);
+	}
+	flat_hash_map(const flat_hash_map &other)
+		: ctrl_(NULL), slots_(NULL), size_(0), capacity_(0), growth_left_(0), hash_(other.hash_), eq_(other.eq_) {
+		reserve(other.size_);
+		for (const_iterator it = other.begin(); it != other.end(); ++it) insert_unique(*it);
+	}
+	flat_hash_map(flat_hash_map &&other)
+		: ctrl_(NULL), slots_(NULL), size_(0), capacity_(0), growth_left_(0), hash_(other.hash_), eq_(other.eq_) {
+		swap(other);
+	}
+	flat_hash_map &operator=(flat_hash_map other) { swap(other); return *this; }
+	~flat_hash_map() { destroy(); }
+
+	void swap(flat_hash_map &other) {
+		std::swap(ctrl_, other.ctrl_);
+		std::swap(slots_, other.slots_);
+		std::swap(size_, other.size_);
+		std::swap(capacity_, other.capacity_);
+		std::swap(growth_left_, other.growth_left_);
+		std::swap(hash_, other.hash_);
+		std::swap(eq_, other.eq_);
+	}
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, capacity_); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, capacity_); }
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	size_t capacity() const { return capacity_; }
+	double load_factor() const { return capacity_ ? static_cast<double>(size_) / capacity_ : 0.0; }
+
+	void clear() {
+		destroy();
+		ctrl_ = NULL;
+		slots_ = NULL;
+		size_ = capacity_ = growth_left_ = 0;
+	}
+
+	// 保证插入 n 个元素之前不会扩容
+	void reserve(size_t n) {
+		size_t cap = kWidth;
+		while (cap - cap / 8 < n) cap <<= 1;
+		if (cap > capacity_) resize(cap);
+	}
+
+	iterator find(const K &key) {
+		return iterator(this, find_index(key));
+	}
+	const_iterator find(const K &key) const {
+		return const_iterator(this, find_index(key));
+	}
+	size_t count(const K &key) const { return find_index(key) != capacity_; }
+	bool contains(const K &key) const { return find_index(key) != capacity_; }
+
+	V &at(const K &key) {
+		size_t i = find_index(key);
+		if (i == capacity_) throw std::out_of_range("flat_hash_map::at");
+		return slots_[i].second;
+	}
+	const V &at(const K &key) const {
+		size_t i = find_index(key);
+		if (i == capacity_) throw std::out_of_range("flat_hash_map::at");
+		return slots_[i].second;
+	}
+
+	V &operator[](const K &key) { return try_emplace(key).first->second; }
+
+	std::pair<iterator, bool> insert(const value_type &value) {
+		return try_emplace(value.first, value.second);
+	}
+
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(const K &key, Args &&... args) {
+		size_t hash = hash_of(key);
+		size_t i = find_index(key, hash);
+		if (i != capacity_) return std::make_pair(iterator(this, i), false);
+		i = prepare_insert(hash);
+		new (&slots_[i]) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+									std::forward_as_tuple(std::forward<Args>(args)...));
+		return std::make_pair(iterator(this, i), true);
+	}
+
+	template <class... Args>
+	std::pair<iterator, bool> emplace(Args &&... args) {
+		value_type value(std::forward<Args>(args)...);
+		size_t hash = hash_of(value.first);
+		size_t i = find_index(value.first, hash);
+		if (i != capacity_) return std::make_pair(iterator(this, i), false);
+		i = prepare_insert(hash);
+		new (&slots_[i]) value_type(std::move(value));
+		return std::make_pair(iterator(this, i), true);
+	}
+
+	size_t erase(const K &key) {
+		size_t i = find_index(key);
+		if (i == capacity_) return 0;
+		erase_index(i);
+		return 1;
+	}
+	// 返回下一个元素的迭代器
+	iterator erase(const_iterator pos) {
+		erase_index(pos.index_);
+		return iterator(this, pos.index_ + 1);
+	}
+
+	// 批量查找：每 kBatch 个 key 先全部算出哈希值并预取起始位置的控制字节和槽位，再依次探测，
+	// 多个 cache miss 同时在途，而不是一次只等一个。
+	// out[i] 为 keys[i] 的迭代器，找不到时为 end()；返回找到的个数
+	size_t find_batch(const K *keys, size_t n, iterator *out) {
+		size_t found = 0, index[kBatch];
+		for (size_t base = 0; base < n; base += kBatch) {
+			size_t m = n - base < kBatch ? n - base : kBatch;
+			find_chunk(keys + base, m, index);
+			for (size_t j = 0; j < m; ++j) {
+				out[base + j] = iterator(this, index[j]);
+				found += index[j] != capacity_;
+			}
+		}
+		return found;
+	}
+	size_t find_batch(const K *keys, size_t n, const_iterator *out) const {
+		size_t found = 0, index[kBatch];
+		for (size_t base = 0; base < n; base += kBatch) {
+			size_t m = n - base < kBatch ? n - base : kBatch;
+			find_chunk(keys + base, m, index);
+			for (size_t j = 0; j < m; ++j) {
+				out[base + j] = const_iterator(this, index[j]);
+				found += index[j] != capacity_;
+			}
+		}
+		return found;
+	}
+
+	// 批量插入（已有的 key 不修改）：先按 size() + n 预留容量，再像 find_batch 一样分批预取；
+	// 返回新插入的个数
+	size_t insert_batch(const value_type *values, size_t n) {
+		if (n == 0) return 0;
+		reserve(size_ + n);
+		size_t inserted = 0, hashes[kBatch];
+		for (size_t base = 0; base < n; base += kBatch) {
+			size_t m = n - base < kBatch ? n - base : kBatch;
+			for (size_t j = 0; j < m; ++j) {
+				hashes[j] = hash_of(values[base + j].first);
+				prefetch(hashes[j]);
+			}
+			for (size_t j = 0; j < m; ++j) {
+				const value_type &value = values[base + j];
+				if (find_index(value.first, hashes[j]) != capacity_) continue;
+				new (&slots_[prepare_insert(hashes[j])]) value_type(value);
+				++inserted;
+			}
+		}
+		return inserted;
+	}
+
+private:
+	size_t hash_of(const K &key) const { return flat_hash_detail::apply_hash<Hash>(hash_(key)); }
+	static size_t h1(size_t hash) { return hash >> 7; }
+	static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+	// 设置控制字节，前 kWidth 个同时写到末尾的副本，使从任意位置取一组都不越界
+	void set_ctrl(size_t i, ctrl_t c) {
+		ctrl_[i] = c;
+		if (i < kWidth) ctrl_[capacity_ + i] = c;
+	}
+
+	size_t find_index(const K &key) const { return capacity_ ? find_index(key, hash_of(key)) : 0; }
+
+	void prefetch(size_t hash) const { __builtin_prefetch(ctrl_ + (h1(hash) & (capacity_ - 1))); }
+
+	// m <= kBatch 个 key 的查找结果写到 index，找不到为 capacity_。分三轮：
+	// 算哈希并预取控制字节；用第一组控制字节匹配 h2，预取第一个匹配的槽位；最后正常探测
+	void find_chunk(const K *keys, size_t m, size_t *index) const {
+		size_t hashes[kBatch];
+		if (!capacity_) {
+			for (size_t j = 0; j < m; ++j) index[j] = 0;
+			return;
+		}
+		for (size_t j = 0; j < m; ++j) {
+			hashes[j] = hash_of(keys[j]);
+			prefetch(hashes[j]);
+		}
+		for (size_t j = 0; j < m; ++j) {
+			size_t pos = h1(hashes[j]) & (capacity_ - 1);
+			flat_hash_detail::BitMask match = Group(ctrl_ + pos).match(h2(hashes[j]));
+			if (match) __builtin_prefetch(slots_ + ((pos + match.lowest()) & (capacity_ - 1)));
+		}
+		for (size_t j = 0; j < m; ++j) index[j] = find_index(keys[j], hashes[j]);
+	}
+
+	// 找到返回下标，找不到返回 capacity_
+	size_t find_index(const K &key, size_t hash) const {
+		if (!capacity_) return 0;
+		size_t mask = capacity_ - 1, pos = h1(hash) & mask, step = 0;
+		int8_t tag = h2(hash);
+		for (;;) {
+			Group g(ctrl_ + pos);
+			for (flat_hash_detail::BitMask m = g.match(tag); m; m.next()) {
+				size_t i = (pos + m.lowest()) & mask;
+				if (eq_(slots_[i].first, key)) return i;
+			}
+			if (g.match_empty()) return capacity_;
+			step += kWidth;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	// 探测序列上第一个空或已删除的槽位
+	size_t find_free(size_t hash) const {
+		size_t mask = capacity_ - 1, pos = h1(hash) & mask, step = 0;
+		for (;;) {
+			flat_hash_detail::BitMask m = Group(ctrl_ + pos).match_empty_or_deleted();
+			if (m) return (pos + m.lowest()) & mask;
+			step += kWidth;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	// 为新元素找槽位并写好控制字节，必要时先扩容
+	size_t prepare_insert(size_t hash) {
+		size_t i = capacity_ ? find_free(hash) : 0;
+		if (!capacity_ || (growth_left_ == 0 && ctrl_[i] == flat_hash_detail::kEmpty)) {
+			// 墓碑较多时按原容量重建即可回收，否则翻倍
+			size_t cap = capacity_ ? capacity_ : kWidth;
+			if (size_ + 1 > cap / 2 - cap / 16) cap <<= 1;
+			resize(cap);
+			i = find_free(hash);
+		}
+		if (ctrl_[i] == flat_hash_detail::kEmpty) --growth_left_;
+		set_ctrl(i, h2(hash));
+		++size_;
+		return i;
+	}
+
+	// 同一组窗口内从未满过的槽位可以直接置空，否则留墓碑以免截断其他 key 的探测序列
+	void erase_index(size_t i) {
+		slots_[i].~value_type();
+		--size_;
+		size_t mask = capacity_ - 1;
+		flat_hash_detail::BitMask after = Group(ctrl_ + i).match_empty();
+		flat_hash_detail::BitMask before = Group(ctrl_ + ((i - kWidth) & mask)).match_empty();
+		bool never_full = after && before &&
+			static_cast<size_t>(after.trailing_zeros() + before.leading_zeros(kWidth)) < kWidth;
+		if (never_full) {
+			set_ctrl(i, flat_hash_detail::kEmpty);
+			++growth_left_;
+		} else {
+			set_ctrl(i, flat_hash_detail::kDeleted);
+		}
+	}
+
+	// 已知 key 不存在时直接插入（复制、重建时使用）
+	void insert_unique(const value_type &value) {
+		size_t i = prepare_insert(hash_of(value.first));
+		new (&slots_[i]) value_type(value);
+	}
+
+	void resize(size_t new_capacity) {
+		ctrl_t *old_ctrl = ctrl_;
+		value_type *old_slots = slots_;
+		size_t old_capacity = capacity_;
+
+		ctrl_ = new ctrl_t[new_capacity + kWidth];
+		memset(ctrl_, flat_hash_detail::kEmpty, new_capacity + kWidth);
+		slots_ = static_cast<value_type *>(::operator new(sizeof(value_type) * new_capacity));
+		capacity_ = new_capacity;
+		growth_left_ = new_capacity - new_capacity / 8;
+
+		for (size_t i = 0; i < old_capacity; ++i) {
+			if (old_ctrl[i] < 0) continue;
+			size_t hash = hash_of(old_slots[i].first);
+			size_t j = find_free(hash);
+			set_ctrl(j, h2(hash));
+			new (&slots_[j]) value_type(std::move(old_slots[i]));
+			old_slots[i].~value_type();
+		}
+		growth_left_ -= size_;
+		delete[] old_ctrl;
+		::operator delete(old_slots);
+	}
+
+	void destroy() {
+		for (size_t i = 0; i < capacity_; ++i)
+			if (ctrl_[i] >= 0) slots_[i].~value_type();
+		delete[] ctrl_;
+		::operator delete(slots_);
+	}
+
+	ctrl_t *ctrl_;
+	value_type *slots_;
+	size_t size_;
+	size_t capacity_;
+	size_t growth_left_;		// 还能占用多少个空槽位（墓碑不算空槽位）
+	Hash hash_;
+	Eq eq_;
+};
+
+#endif
@@ -0,0 +1,163 @@
+// 用实际的 key 集合检查哈希函数的分布：把 key 插入线性探测表（大小为 2 的幂，掩码取位置），
+// 统计每个 key 查找命中时的探测长度（1 表示一次命中），输出直方图、平均值和最大值。
+//
+// 整数 key 对比的哈希函数：
+//   3k%m     原 HashTable.cpp 的 (3*key)%m，表大小取大于容量的素数（参照，有除法）
+//   identity 整数的 std::hash（恒等映射）直接取掩码
+//   fibonacci / wyhash / xxh3   见 Hashers.h
+// 字符串 key 对比 std::hash<std::string> 和 wyhash（即 hashed_string 缓存的值）。
+//
+// 编译：g++ -std=c++11 -O2 HashProbeHist.cpp -o HashProbeHist
+// 用法：./HashProbeHist [-f 文件] [-g seq|stride|random] [-n 个数] [-s 步长] [-l 负载百分比]
+//   -f：每行一个 key，全部是整数时按整数处理，否则按字符串处理；不给 -f 时按 -g 生成整数 key
+//   默认 -g seq -n 1000000 -s 1024 -l 50
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "Hashers.h"
+
+// 探测长度分组的上界
+static const size_t kBuckets[] = { 1, 2, 3, 4, 8, 16, 64, 256, (size_t)-1 };
+static const size_t kBucketCount = sizeof(kBuckets) / sizeof(kBuckets[0]);
+
+static void print_header() {
+	printf("%-10s %7s %7s", "hash", "mean", "max");
+	size_t lo = 1;
+	for (size_t b = 0; b < kBucketCount; ++b) {
+		char label[32];
+		if (kBuckets[b] == (size_t)-1) snprintf(label, sizeof(label), ">%zu", lo - 1);
+		else if (kBuckets[b] == lo) snprintf(label, sizeof(label), "%zu", lo);
+		else snprintf(label, sizeof(label), "%zu-%zu", lo, kBuckets[b]);
+		printf(" %7s", label);
+		lo = kBuckets[b] + 1;
+	}
+	printf("\n");
+}
+
+// home[i] 为第 i 个 key 的起始位置（已取掩码或取模）；按插入顺序放入表中，
+// 探测长度 = 最终位置到起始位置的距离 + 1，与之后查找命中时的探测次数相同
+static void report(const char *name, const std::vector<size_t> &home, size_t capacity) {
+	std::vector<char> used(capacity, 0);
+	std::vector<size_t> hist(kBucketCount, 0);
+	size_t max = 0;
+	double total = 0;
+	for (size_t i = 0; i < home.size(); ++i) {
+		size_t p = home[i], len = 1;
+		while (used[p]) {
+			p = p + 1 == capacity ? 0 : p + 1;
+			++len;
+		}
+		used[p] = 1;
+		total += len;
+		if (len > max) max = len;
+		size_t b = 0;
+		while (len > kBuckets[b]) ++b;
+		++hist[b];
+	}
+	printf("%-10s %7.2f %7zu", name, total / home.size(), max);
+	for (size_t b = 0; b < kBucketCount; ++b) printf(" %6.2f%%", 100.0 * hist[b] / home.size());
+	printf("\n");
+}
+
+template <class Key, class F>
+static void run(const char *name, const std::vector<Key> &keys, size_t capacity, F hash) {
+	std::vector<size_t> home(keys.size());
+	for (size_t i = 0; i < keys.size(); ++i) home[i] = hash(keys[i]) & (capacity - 1);
+	report(name, home, capacity);
+}
+
+static bool is_prime(size_t n) {
+	if (n < 2) return false;
+	for (size_t d = 2; d * d <= n; ++d)
+		if (n % d == 0) return false;
+	return true;
+}
+
+static void run_integers(const std::vector<uint64_t> &keys, size_t capacity) {
+	// 原来的除留余数法：表大小取素数
+	size_t prime = capacity + 1;
+	while (!is_prime(prime)) ++prime;
+	std::vector<size_t> home(keys.size());
+	for (size_t i = 0; i < keys.size(); ++i) home[i] = static_cast<size_t>((3 * keys[i]) % prime);
+	report("3k%m", home, prime);
+
+	run("identity", keys, capacity, std::hash<uint64_t>());
+	run("fibonacci", keys, capacity, fibonacci_hash());
+	run("wyhash", keys, capacity, wy_hash());
+	run("xxh3", keys, capacity, xxh3_hash());
+}
+
+static void run_strings(const std::vector<std::string> &keys, size_t capacity) {
+	run("std::hash", keys, capacity, std::hash<std::string>());
+	run("wyhash", keys, capacity, wy_hash());
+}
+
+int main(int argc, char *argv[]) {
+	const char *file = NULL, *pattern = "seq";
+	size_t n = 1000000, stride = 1024, load = 50;
+	int opt;
+	while ((opt = getopt(argc, argv, "f:g:n:s:l:")) != -1) {
+		switch (opt) {
+		case 'f': file = optarg; break;
+		case 'g': pattern = optarg; break;
+		case 'n': n = strtoull(optarg, NULL, 10); break;
+		case 's': stride = strtoull(optarg, NULL, 10); break;
+		case 'l': load = strtoull(optarg, NULL, 10); break;
+		default:
+			fprintf(stderr, "usage: %s [-f file] [-g seq|stride|random] [-n count] [-s stride] [-l load%%]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (load == 0 || load >= 100) {
+		fprintf(stderr, "load must be in 1..99\n");
+		return 1;
+	}
+
+	std::vector<std::string> lines;
+	std::vector<uint64_t> ints;
+	bool numeric = true;
+	if (file) {
+		FILE *fp = fopen(file, "r");
+		if (!fp) {
+			perror(file);
+			return 1;
+		}
+		char buf[4096];
+		while (fgets(buf, sizeof(buf), fp)) {
+			buf[strcspn(buf, "\r\n")] = '\0';
+			char *end;
+			unsigned long long v = strtoull(buf, &end, 10);
+			if (*buf == '\0' || *end != '\0') numeric = false;
+			lines.push_back(buf);
+			ints.push_back(v);
+		}
+		fclose(fp);
+	} else {
+		uint64_t state = 1;
+		for (size_t i = 0; i < n; ++i) {
+			if (strcmp(pattern, "stride") == 0) ints.push_back(i * stride);
+			else if (strcmp(pattern, "random") == 0) ints.push_back(hashers::wyhash64(state++));
+			else ints.push_back(i);
+		}
+	}
+	size_t count = numeric ? ints.size() : lines.size();
+	if (count == 0) {
+		fprintf(stderr, "no keys\n");
+		return 1;
+	}
+	size_t capacity = 1;
+	while (capacity * load < count * 100) capacity <<= 1;
+
+	printf("%zu %s keys%s%s, capacity %zu, load %.1f%%\n", count, numeric ? "integer" : "string",
+		   file ? "" : ", pattern ", file ? "" : pattern, capacity, 100.0 * count / capacity);
+	print_header();
+	if (numeric) run_integers(ints, capacity);
+	else run_strings(lines, capacity);
+	return 0;
+}
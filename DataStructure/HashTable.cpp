@@ -1,5 +1,7 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<stdint.h>
+#include "Hashers.h"
 
 #define SUCCESS 1
 #define UNSUCCESS 0
@@ -7,6 +9,8 @@
 #define OK 1
 #define ERROR -1
 #define MAXNUM 9999		// 用于初始化哈希表的记录 key
+#define REHASH_STEP 4	// 迁移过程中每次插入 / 删除顺带迁移的记录数
+#define BATCH_SIZE 32	// 批量操作每次预取的 key 数
 
 typedef int Status;
 typedef int KeyType;
@@ -14,120 +18,292 @@ typedef int KeyType;
 // 哈希表中的记录类型
 typedef struct {
 	KeyType key;
+	uint64_t hash;	// 缓存的哈希值：查找时先比较它，删除前移和扩容迁移时不用重新计算
 }RcdType;
 
-// 哈希表类型
+// 哈希函数类型，返回 64 位哈希值，由表大小的掩码取低位得到位置
+typedef uint64_t (*HashFunc)(KeyType key);
+
+// 一张线性探测表，大小为 2 的幂
 typedef struct {
 	RcdType *rcd;
 	int size;
 	int count;
-	int *tag;
-}HashTable;
+	int *tag;		// 1 表示有记录，0 表示空；删除时把后面的记录前移，不留删除标记
+}Table;
 
-// 哈希表每次重建增长后的大小
-int hashsize[] = { 11, 31, 61, 127, 251, 503 };
-int index = 0;
+// 哈希表类型：扩容时新建 ht[1]，每次操作顺带把 ht[0] 中的几条记录迁移过去，
+// 迁移完成后 ht[1] 成为 ht[0]，不会因为一次性重建整张表而停顿
+typedef struct {
+	Table ht[2];
+	int rehashidx;	// ht[0] 中下一个待迁移的位置，-1 表示没有在迁移
+	HashFunc hash;
+}HashTable;
 
-// 初始哈希表
-Status InitHashTable(HashTable &H, int size) {
+// 初始化一张表
+Status InitTable(Table &T, int size) {
 	int i;
-	H.rcd = (RcdType *)malloc(sizeof(RcdType)*size);
-	H.tag = (int *)malloc(sizeof(int)*size);
-	if (NULL == H.rcd || NULL == H.tag) return OVERFLOW;
+	T.rcd = (RcdType *)malloc(sizeof(RcdType)*size);
+	T.tag = (int *)malloc(sizeof(int)*size);
+	if (NULL == T.rcd || NULL == T.tag) return OVERFLOW;
 	KeyType maxNum = MAXNUM;
 	for (i = 0; i < size; i++) {
-		H.tag[i] = 0;
-		H.rcd[i].key = maxNum;
+		T.tag[i] = 0;
+		T.rcd[i].key = maxNum;
+		T.rcd[i].hash = 0;
 	}
-	H.size = size;
-	H.count = 0;
+	T.size = size;
+	T.count = 0;
 	return OK;
 }
 
-// 哈希函数：除留余数法
-int Hash(KeyType key, int m) {
-	return (3 * key) % m;
+void FreeTable(Table &T) {
+	free(T.rcd);
+	free(T.tag);
+	T.rcd = NULL;
+	T.tag = NULL;
+	T.size = 0;
+	T.count = 0;
+}
+
+// 可选的哈希函数（见 Hashers.h），key 按无符号数处理，负数 key 也可以
+uint64_t FibHash(KeyType key) { return hashers::fibonacci64((uint32_t)key); }
+uint64_t WyHash(KeyType key) { return hashers::wyhash64((uint32_t)key); }
+uint64_t Xxh3Hash(KeyType key) { return hashers::xxh3_64((uint32_t)key); }
+
+// 初始哈希表：size 向上取为 2 的幂，hash 为 NULL 时用 FibHash
+Status InitHashTable(HashTable &H, int size, HashFunc hash) {
+	int n = 8;
+	while (n < size) n <<= 1;
+	H.hash = hash ? hash : FibHash;
+	H.ht[1].rcd = NULL;
+	H.ht[1].tag = NULL;
+	H.ht[1].size = 0;
+	H.ht[1].count = 0;
+	H.rehashidx = -1;
+	return InitTable(H.ht[0], n);
+}
+
+// 销毁哈希表
+void DestroyHashTable(HashTable &H) {
+	FreeTable(H.ht[0]);
+	if (-1 != H.rehashidx) FreeTable(H.ht[1]);
+	H.rehashidx = -1;
+}
+
+// 起始位置：表大小为 2 的幂，用掩码代替取模，探测时没有除法
+int Home(uint64_t hash, int m) {
+	return (int)(hash & (uint64_t)(m - 1));
 }
 
 // 处理哈希冲突：线性探测
 void collision(int &p, int m) {
-	p = (p + 1) % m;
+	p = (p + 1) & (m - 1);
 }
 
-// 在哈希表中查询
-Status SearchHash(HashTable H, KeyType key, int &p, int &c) {
-	p = Hash(key, H.size);
-	int h = p;
+// 在一张表中查询：找到时 p 为记录位置，否则 p 为可以插入的空位置，c 为冲突次数
+Status SearchTable(Table T, KeyType key, uint64_t hash, int &p, int &c) {
+	p = Home(hash, T.size);
 	c = 0;
-	while ((1 == H.tag[p] && H.rcd[p].key != key) || -1 == H.tag[p]) {
-		collision(p, H.size);  c++;
+	while (1 == T.tag[p] && (T.rcd[p].hash != hash || T.rcd[p].key != key)) {
+		collision(p, T.size);  c++;
 	}
 
-	if (1 == H.tag[p] && key == H.rcd[p].key) return SUCCESS;
+	if (1 == T.tag[p]) return SUCCESS;
 	else return UNSUCCESS;
 }
 
-//打印哈希表
-void printHash(HashTable H)
+// 在哈希表中查询：迁移过程中两张表都要查，p 为记录在所在表中的位置
+Status SearchHash(HashTable H, KeyType key, int &p, int &c) {
+	uint64_t hash = H.hash(key);
+	if (SUCCESS == SearchTable(H.ht[0], key, hash, p, c)) return SUCCESS;
+	if (-1 != H.rehashidx) {
+		int c1;
+		Status s = SearchTable(H.ht[1], key, hash, p, c1);
+		c += c1;
+		return s;
+	}
+	return UNSUCCESS;
+}
+
+// 插入一张表（调用方保证 key 不存在且表未满）
+void InsertTable(Table &T, KeyType key, uint64_t hash) {
+	int p, c;
+	SearchTable(T, key, hash, p, c);
+	T.rcd[p].key = key;
+	T.rcd[p].hash = hash;
+	T.tag[p] = 1;
+	T.count++;
+}
+
+// 删除一张表中位置 p 的记录：向后扫描同一个簇，把能放到空位上的记录前移，
+// 使表中始终没有删除标记，查找不用跨过已删除的位置
+void DeleteTable(Table &T, int p) {
+	int i = p, j = p, h;
+	for (;;) {
+		collision(j, T.size);
+		if (0 == T.tag[j]) break;
+		h = Home(T.rcd[j].hash, T.size);
+		// h 不在循环区间 (i, j] 内时，j 上的记录可以移到空位 i
+		if ((i <= j) ? (h <= i || h > j) : (h <= i && h > j)) {
+			T.rcd[i] = T.rcd[j];
+			i = j;
+		}
+	}
+	T.tag[i] = 0;
+	T.rcd[i].key = MAXNUM;
+	T.rcd[i].hash = 0;
+	T.count--;
+}
+
+// 迁移结束：新表成为 ht[0]
+void finishRehash(HashTable &H) {
+	FreeTable(H.ht[0]);
+	H.ht[0] = H.ht[1];
+	H.ht[1].rcd = NULL;
+	H.ht[1].tag = NULL;
+	H.ht[1].size = 0;
+	H.ht[1].count = 0;
+	H.rehashidx = -1;
+}
+
+// 迁移最多 n 条记录，最多跳过 10n 个空位置，保证每次操作的额外开销有上限
+void rehashStep(HashTable &H, int n) {
+	int empty_visits = n * 10;
+	while (n > 0 && -1 != H.rehashidx) {
+		Table &old = H.ht[0];
+		if (0 == old.count || H.rehashidx >= old.size) {
+			finishRehash(H);
+			return;
+		}
+		if (0 == old.tag[H.rehashidx]) {
+			H.rehashidx++;
+			if (--empty_visits == 0) return;
+			continue;
+		}
+		// 删除时后面的记录可能前移到当前位置，所以 rehashidx 不前进；
+		// 记录只会移到 rehashidx 及之后的位置，已经扫过的位置始终为空，不会漏掉
+		InsertTable(H.ht[1], old.rcd[H.rehashidx].key, old.rcd[H.rehashidx].hash);
+		DeleteTable(old, H.rehashidx);
+		n--;
+	}
+}
+
+// 开始扩容：新表大小为原来的 2 倍，没有上限
+Status startRehash(HashTable &H) {
+	if (OK != InitTable(H.ht[1], H.ht[0].size * 2)) return OVERFLOW;
+	H.rehashidx = 0;
+	return OK;
+}
+
+//打印一张表
+void printTable(Table T)
 {
 	int  i;
 	printf("key : ");
-	for (i = 0; i < H.size; i++)
-		printf("%3d ", H.rcd[i].key);
+	for (i = 0; i < T.size; i++)
+		printf("%4d ", T.rcd[i].key);
 	printf("\n");
 	printf("tag : ");
-	for (i = 0; i < H.size; i++)
-		printf("%3d ", H.tag[i]);
-	printf("\n\n");
-}
-
-// 函数声明：插入哈希表
-Status InsertHash(HashTable &H, KeyType key);
-
-// 重建哈希表
-Status recreateHash(HashTable &H) {
-	RcdType *orcd;
-	int *otag, osize, i;
-	orcd = H.rcd;
-	otag = H.tag;
-	osize = H.size;
-
-	InitHashTable(H, hashsize[index++]);
-	//把所有元素，按照新哈希函数放到新表中
-	for (i = 0; i < osize; i++) {
-		if (1 == otag[i]) {
-			InsertHash(H, orcd[i].key);
-		}
+	for (i = 0; i < T.size; i++)
+		printf("%4d ", T.tag[i]);
+	printf("\n");
+}
+
+//打印哈希表
+void printHash(HashTable H)
+{
+	printTable(H.ht[0]);
+	if (-1 != H.rehashidx) {
+		printf("正在迁移（下一个位置 %d），新表：\n", H.rehashidx);
+		printTable(H.ht[1]);
 	}
-	return OK;
+	printf("\n");
 }
 
-// 插入哈希表
-Status InsertHash(HashTable &H, KeyType key) {
+// 插入哈希表：负载因子超过 1/2 时开始扩容，迁移过程中新记录插入新表
+Status InsertHashed(HashTable &H, KeyType key, uint64_t hash) {
 	int p, c;
-	if (UNSUCCESS == SearchHash(H, key, p, c)) { //没有相同key
-		if (c*1.0 / H.size < 0.5) { //冲突次数未达到上线
-			//插入代码
-			H.rcd[p].key = key;
-			H.tag[p] = 1;
-			H.count++;
-			return SUCCESS;
+	if (SUCCESS == SearchTable(H.ht[0], key, hash, p, c)) return UNSUCCESS; //已有相同key
+	if (-1 != H.rehashidx && SUCCESS == SearchTable(H.ht[1], key, hash, p, c)) return UNSUCCESS;
+	if (-1 != H.rehashidx && (H.ht[1].count + 1) * 2 > H.ht[1].size) {
+		// 新表也快满了（正常情况下迁移早已完成），先把剩下的迁移完
+		while (-1 != H.rehashidx) rehashStep(H, H.ht[0].size);
+	}
+	if (-1 == H.rehashidx && (H.ht[0].count + 1) * 2 > H.ht[0].size) {
+		if (OK != startRehash(H)) return OVERFLOW;
+	}
+	InsertTable(-1 != H.rehashidx ? H.ht[1] : H.ht[0], key, hash);
+	rehashStep(H, REHASH_STEP);
+	return SUCCESS;
+}
+
+Status InsertHash(HashTable &H, KeyType key) {
+	return InsertHashed(H, key, H.hash(key));
+}
+
+// 预取 key 在表中起始位置的记录和标记
+void PrefetchTable(Table T, uint64_t hash) {
+	int p = Home(hash, T.size);
+	__builtin_prefetch(&T.rcd[p]);
+	__builtin_prefetch(&T.tag[p]);
+}
+
+// 批量查询：每 BATCH_SIZE 个 key 先算出全部哈希值并预取起始位置，再依次探测，
+// 多个 cache miss 同时在途，而不是一次只等一个。found[i] 为 keys[i] 的结果，返回查到的个数
+int SearchHashBatch(HashTable H, KeyType keys[], int n, Status found[]) {
+	uint64_t hash[BATCH_SIZE];
+	int i, j, m, p, c, total = 0;
+	for (i = 0; i < n; i += BATCH_SIZE) {
+		m = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+		for (j = 0; j < m; j++) {
+			hash[j] = H.hash(keys[i + j]);
+			PrefetchTable(H.ht[0], hash[j]);
+			if (-1 != H.rehashidx) PrefetchTable(H.ht[1], hash[j]);
+		}
+		for (j = 0; j < m; j++) {
+			found[i + j] = SearchTable(H.ht[0], keys[i + j], hash[j], p, c);
+			if (SUCCESS != found[i + j] && -1 != H.rehashidx)
+				found[i + j] = SearchTable(H.ht[1], keys[i + j], hash[j], p, c);
+			if (SUCCESS == found[i + j]) total++;
 		}
-		else recreateHash(H); //重构哈希表 
 	}
-	return UNSUCCESS;
+	return total;
+}
+
+// 批量插入：与批量查询一样先预取，已有的 key 跳过；返回插入的个数，内存不足时返回 OVERFLOW
+int InsertHashBatch(HashTable &H, KeyType keys[], int n) {
+	uint64_t hash[BATCH_SIZE];
+	int i, j, m, total = 0;
+	Status s;
+	for (i = 0; i < n; i += BATCH_SIZE) {
+		m = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+		for (j = 0; j < m; j++) {
+			hash[j] = H.hash(keys[i + j]);
+			PrefetchTable(-1 != H.rehashidx ? H.ht[1] : H.ht[0], hash[j]);
+		}
+		for (j = 0; j < m; j++) {
+			s = InsertHashed(H, keys[i + j], hash[j]);
+			if (OVERFLOW == s) return OVERFLOW;
+			if (SUCCESS == s) total++;
+		}
+	}
+	return total;
 }
 
 // 删除哈希表
 Status DeleteHash(HashTable &H, KeyType key) {
 	int p, c;
-	if (SUCCESS == SearchHash(H, key, p, c)) {
-		//删除代码
-		H.tag[p] = -1;
-		H.count--;
-		return SUCCESS;
+	uint64_t hash = H.hash(key);
+	if (SUCCESS == SearchTable(H.ht[0], key, hash, p, c)) {
+		DeleteTable(H.ht[0], p);
+	}
+	else if (-1 != H.rehashidx && SUCCESS == SearchTable(H.ht[1], key, hash, p, c)) {
+		DeleteTable(H.ht[1], p);
 	}
 	else return UNSUCCESS;
+	rehashStep(H, REHASH_STEP);
+	return SUCCESS;
 }
 
 int main()
@@ -135,13 +311,13 @@ int main()
 	printf("-----哈希表-----\n");
 	HashTable H;
 	int i;
-	int size = 11;
+	int size = 16;
 	KeyType array[8] = { 22, 41, 53, 46, 30, 13, 12, 67 };
 	KeyType key;
 
-	//初始化哈希表
+	//初始化哈希表，哈希函数可以换成 WyHash、Xxh3Hash
 	printf("初始化哈希表\n");
-	if (SUCCESS == InitHashTable(H, hashsize[index++])) printf("初始化成功\n");
+	if (OK == InitHashTable(H, size, FibHash)) printf("初始化成功\n");
 
 	//插入哈希表
 	printf("插入哈希表\n");
@@ -163,8 +339,8 @@ int main()
 	printf("查询哈希表中key为67的元素\n");
 	if (SUCCESS == SearchHash(H, 67, p, c)) printf("查询成功\n");
 
-	//再次插入，测试哈希表的重建
-	printf("再次插入，测试哈希表的重建：\n");
+	//再次插入，测试哈希表的扩容
+	printf("再次插入，测试哈希表的扩容：\n");
 	KeyType array1[8] = { 27, 47, 57, 47, 37, 17, 93, 67 };
 	for (i = 0; i <= 7; i++) {
 		key = array1[i];
@@ -172,6 +348,20 @@ int main()
 		printHash(H);
 	}
 
+	//大量插入和删除：每次操作只迁移几条记录，删除后表中没有删除标记
+	printf("批量插入 100000 个元素，再删除其中的偶数，然后批量查询：\n");
+	KeyType *keys = (KeyType *)malloc(sizeof(KeyType) * 100000);
+	Status *result = (Status *)malloc(sizeof(Status) * 100000);
+	for (i = 0; i < 100000; i++) keys[i] = i;
+	InsertHashBatch(H, keys, 100000);
+	for (i = 0; i < 100000; i += 2) DeleteHash(H, i);
+	int found = SearchHashBatch(H, keys, 100000, result);
+	free(keys);
+	free(result);
+	printf("剩余 %d 个元素，查到 %d 个，表大小 %d\n", H.ht[0].count + H.ht[1].count, found,
+		-1 != H.rehashidx ? H.ht[1].size : H.ht[0].size);
+	DestroyHashTable(H);
+
 	getchar();
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,167 @@
+#ifndef HASHERS_H
+#define HASHERS_H
+
+// 可替换的哈希函数
+//
+// - wyhash：任意字节串（按 wyhash final4 实现），以及两个 64 位整数的快速版本 wyhash64；
+// - xxh3_64：XXH3 处理 4~8 字节输入的路径（异或常数后做 rrmxmx 混合），适合整数 key，
+//   常数取自己的值，结果与 xxhash 库不逐位相同；
+// - fibonacci_hash：乘以 2^64/φ，一条乘法；乘积的低位只取决于 key 的低位，
+//   所以按字节反转，让 2 的幂掩码取到的是混合最充分的高位字节。
+//
+// 函数对象 wy_hash / xxh3_hash / fibonacci_hash 可以作为 flat_hash_map 的 Hash 参数。
+// 定义了 is_avalanching 的函数对象输出已经充分混合，flat_hash_map 不再额外打散。
+//
+// hashed_string 在构造时算好 wyhash 并缓存，查找、扩容、比较时都不用重新计算。
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace hashers {
+
+static const uint64_t kWyp0 = 0x2d358dccaa6c78a5ULL;
+static const uint64_t kWyp1 = 0x8bb84b93962eacc9ULL;
+static const uint64_t kWyp2 = 0x4b33a62ed433d4a3ULL;
+static const uint64_t kWyp3 = 0x4d5a2da51de1aa47ULL;
+
+// 64 位乘 64 位得到 128 位积，低 64 位写回 a，高 64 位写回 b
+inline void wymum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 r = static_cast<unsigned __int128>(*a) * *b;
+	*a = static_cast<uint64_t>(r);
+	*b = static_cast<uint64_t>(r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t wymix(uint64_t a, uint64_t b) {
+	wymum(&a, &b);
+	return a ^ b;
+}
+
+inline uint64_t wyr8(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+inline uint64_t wyr4(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+inline uint64_t wyr3(const uint8_t *p, size_t k) {
+	return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+inline uint64_t wyhash(const void *key, size_t len, uint64_t seed = 0) {
+	const uint8_t *p = static_cast<const uint8_t *>(key);
+	uint64_t a, b;
+	seed ^= wymix(seed ^ kWyp0, kWyp1);
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+		} else if (len > 0) {
+			a = wyr3(p, len);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		if (i >= 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = wymix(wyr8(p) ^ kWyp1, wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ kWyp2, wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ kWyp3, wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = wymix(wyr8(p) ^ kWyp1, wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+	a ^= kWyp1;
+	b ^= seed;
+	wymum(&a, &b);
+	return wymix(a ^ kWyp0 ^ len, b ^ kWyp1);
+}
+
+inline uint64_t wyhash64(uint64_t a, uint64_t b = 0) {
+	a ^= kWyp0;
+	b ^= kWyp1;
+	wymum(&a, &b);
+	return wymix(a ^ kWyp0, b ^ kWyp1);
+}
+
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t xxh3_64(uint64_t x, uint64_t seed = 0) {
+	uint64_t h = x ^ (0xc73ab174c5ecd5a2ULL - seed);
+	h ^= rotl64(h, 49) ^ rotl64(h, 24);
+	h *= 0x9FB21C651E98DF25ULL;
+	h ^= (h >> 35) + 8;
+	h *= 0x9FB21C651E98DF25ULL;
+	return h ^ (h >> 28);
+}
+
+inline uint64_t fibonacci64(uint64_t x) { return __builtin_bswap64(x * 0x9E3779B97F4A7C15ULL); }
+
+}  // namespace hashers
+
+// 缓存了哈希值的字符串 key
+class hashed_string {
+public:
+	hashed_string() : hash_(hashers::wyhash("", 0)) { }
+	hashed_string(const std::string &s) : str_(s), hash_(hashers::wyhash(s.data(), s.size())) { }
+	hashed_string(const char *s) : str_(s), hash_(hashers::wyhash(str_.data(), str_.size())) { }
+	const std::string &str() const { return str_; }
+	uint64_t hash() const { return hash_; }
+	// 先比较哈希值，不同的字符串基本不用逐字节比较
+	bool operator==(const hashed_string &other) const { return hash_ == other.hash_ && str_ == other.str_; }
+	bool operator!=(const hashed_string &other) const { return !(*this == other); }
+private:
+	std::string str_;
+	uint64_t hash_;
+};
+
+struct wy_hash {
+	typedef void is_avalanching;
+	size_t operator()(uint64_t x) const { return hashers::wyhash64(x); }
+	size_t operator()(const std::string &s) const { return hashers::wyhash(s.data(), s.size()); }
+	size_t operator()(const hashed_string &s) const { return s.hash(); }
+};
+
+struct xxh3_hash {
+	typedef void is_avalanching;
+	size_t operator()(uint64_t x) const { return hashers::xxh3_64(x); }
+};
+
+struct fibonacci_hash {
+	size_t operator()(uint64_t x) const { return hashers::fibonacci64(x); }
+};
+
+namespace std {
+template <>
+struct hash<hashed_string> {
+	typedef void is_avalanching;
+	size_t operator()(const hashed_string &s) const { return s.hash(); }
+};
+}  // namespace std
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+// 离线构建、运行时只读的最小完美哈希表（PTHash/CHD 方式）
+//
+// 构建（mph_builder）：
+// - 每个 key 算两个 64 位哈希：h1 决定所在的桶（平均每桶 4 个 key），h2 决定位置；
+// - 按桶从大到小依次为每个桶找一个 pilot，使桶内所有 key 的位置
+//   fastrange(h2 ^ wyhash64(pilot), table_size) 互不相同且没被占用；table_size = n / 0.99；
+// - 被占用的位置记在位图里，位置在位图中的秩（前面有几个 1）就是 0..n-1 的最小完美编号，
+//   每 64 位位图后面紧跟它之前 1 的个数，求秩只读一个缓存行、做一次 popcount；
+// - 按编号顺序写出 [key 长度][value 长度][key][value] 记录和每条记录的偏移。
+//
+// 查找（mph_table）：mmap 整个文件（MAP_SHARED 只读，多个进程共享同一份页缓存），
+// 打开时用 MADV_WILLNEED 让内核在后台预读，不阻塞；
+// 只检查文件头，不需要重建；一次查找 = 两次哈希 + 读 pilot + 位图 + 偏移 + 比较 key。
+// 不在表中的 key 也会落到某个位置上，由最后比较 key 排除，不会误报。
+//
+// 文件按本机字节序（小端）写出，只在同种机器间使用。出错时返回 false 并设置 errno。
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Hashers.h"
+
+namespace mph_detail {
+
+static const char kMagic[8] = { 'M', 'P', 'H', 'T', 'B', 'L', '1', '\0' };
+
+// 各段相对文件开头的偏移都按 64 字节对齐
+struct header {
+	char magic[8];
+	uint64_t seed;
+	uint64_t count;			// key 个数 n
+	uint64_t table_size;	// 位置空间大小，略大于 n
+	uint64_t buckets;
+	uint64_t pilots_off;	// uint32_t[buckets]
+	uint64_t bits_off;		// uint64_t[2 * ((table_size + 63) / 64)]，交替存放位图和该字之前 1 的个数
+	uint64_t offsets_off;	// uint64_t[count]，第 i 条记录的偏移
+	uint64_t data_off;
+	uint64_t file_size;
+};
+
+// 把 64 位哈希均匀映射到 [0, n)，没有除法
+inline uint64_t fastrange(uint64_t h, uint64_t n) {
+#if defined(__SIZEOF_INT128__)
+	return static_cast<uint64_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+#else
+	return h % n;
+#endif
+}
+
+inline uint64_t hash1(const void *key, size_t len, uint64_t seed) { return hashers::wyhash(key, len, seed); }
+inline uint64_t hash2(uint64_t h1) { return hashers::wymix(h1 ^ hashers::kWyp2, hashers::kWyp3); }
+inline uint64_t position(uint64_t h2, uint32_t pilot, uint64_t seed, uint64_t table_size) {
+	return fastrange(h2 ^ hashers::wyhash64(pilot, seed), table_size);
+}
+
+inline uint64_t align64(uint64_t x) { return (x + 63) & ~static_cast<uint64_t>(63); }
+
+// 位置 p 之前被占用的位置个数
+inline uint64_t rank(const uint64_t *bits, uint64_t p) {
+	return bits[p / 64 * 2 + 1] + __builtin_popcountll(bits[p / 64 * 2] & ((1ULL << (p % 64)) - 1));
+}
+
+}  // namespace mph_detail
+
+class mph_builder {
+public:
+	void add(const std::string &key, const std::string &value) {
+		keys_.push_back(key);
+		values_.push_back(value);
+	}
+	size_t size() const { return keys_.size(); }
+
+	// 构建并写到 path；有重复 key 时返回 false，errno 为 EINVAL
+	bool build(const char *path) {
+		using namespace mph_detail;
+		size_t n = keys_.size();
+		header h;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, kMagic, sizeof(kMagic));
+		h.count = n;
+		h.table_size = n + n / 99 + 1;
+		h.buckets = n / 4 + 1;
+
+		std::vector<uint32_t> pilots;
+		std::vector<uint64_t> pos(n);
+		bool ok = false;
+		for (uint64_t seed = 0x5eed; !ok && seed < 0x5eed + 16; ++seed) {
+			h.seed = seed;
+			int r = search(h, pilots, pos);
+			if (r < 0) {
+				errno = EINVAL;
+				return false;
+			}
+			ok = r > 0;
+		}
+		if (!ok) {
+			errno = EAGAIN;
+			return false;
+		}
+
+		// 位图和前缀计数交替存放
+		size_t words = (h.table_size + 63) / 64;
+		std::vector<uint64_t> bits(2 * words, 0);
+		for (size_t i = 0; i < n; ++i) bits[pos[i] / 64 * 2] |= 1ULL << (pos[i] % 64);
+		for (size_t w = 1; w < words; ++w) bits[2 * w + 1] = bits[2 * w - 1] + __builtin_popcountll(bits[2 * w - 2]);
+
+		// 第 rank(pos[i]) 条记录放 key i
+		std::vector<size_t> order(n);
+		for (size_t i = 0; i < n; ++i) order[rank(bits.data(), pos[i])] = i;
+
+		h.pilots_off = align64(sizeof(header));
+		h.bits_off = align64(h.pilots_off + pilots.size() * sizeof(uint32_t));
+		h.offsets_off = align64(h.bits_off + 2 * words * sizeof(uint64_t));
+		h.data_off = align64(h.offsets_off + n * sizeof(uint64_t));
+		std::vector<uint64_t> offsets(n);
+		uint64_t off = h.data_off;
+		for (size_t r = 0; r < n; ++r) {
+			offsets[r] = off;
+			off += record_size(order[r]);
+		}
+		h.file_size = off;
+
+		// 先写临时文件再 rename，正在使用旧文件的进程不受影响
+		std::string tmp = std::string(path) + ".tmp";
+		FILE *fp = fopen(tmp.c_str(), "wb");
+		if (!fp) return false;
+		bool written = write_at(fp, 0, &h, sizeof(h)) &&
+			write_at(fp, h.pilots_off, pilots.data(), pilots.size() * sizeof(uint32_t)) &&
+			write_at(fp, h.bits_off, bits.data(), 2 * words * sizeof(uint64_t)) &&
+			write_at(fp, h.offsets_off, offsets.data(), n * sizeof(uint64_t));
+		for (size_t r = 0; written && r < n; ++r) written = write_record(fp, offsets[r], order[r]);
+		written = written && fflush(fp) == 0 && ftruncate(fileno(fp), static_cast<off_t>(h.file_size)) == 0 &&
+			fsync(fileno(fp)) == 0;
+		int saved = errno;
+		if (fclose(fp) != 0 && written) {
+			saved = errno;
+			written = false;
+		}
+		if (!written || rename(tmp.c_str(), path) != 0) {
+			if (written) saved = errno;
+			unlink(tmp.c_str());
+			errno = saved;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	static const uint32_t kMaxPilot = 1u << 20;
+
+	// 为所有桶找 pilot：1 成功，0 需要换 seed，-1 有重复 key
+	int search(const mph_detail::header &h, std::vector<uint32_t> &pilots, std::vector<uint64_t> &pos) {
+		using namespace mph_detail;
+		size_t n = keys_.size();
+		std::vector<uint64_t> h2(n);
+		std::vector<std::pair<uint64_t, size_t> > by_bucket(n);		// (桶号, key 下标)
+		for (size_t i = 0; i < n; ++i) {
+			uint64_t a = hash1(keys_[i].data(), keys_[i].size(), h.seed);
+			h2[i] = hash2(a);
+			by_bucket[i] = std::make_pair(fastrange(a, h.buckets), i);
+		}
+		std::sort(by_bucket.begin(), by_bucket.end());
+
+		// 桶按大小从大到小处理：大桶在表还空的时候更容易放下
+		std::vector<std::pair<size_t, size_t> > ranges;		// 每个非空桶在 by_bucket 中的区间
+		for (size_t i = 0; i < n;) {
+			size_t j = i;
+			while (j < n && by_bucket[j].first == by_bucket[i].first) ++j;
+			ranges.push_back(std::make_pair(i, j));
+			i = j;
+		}
+		std::stable_sort(ranges.begin(), ranges.end(), bigger_bucket);
+
+		pilots.assign(h.buckets, 0);
+		std::vector<uint64_t> taken((h.table_size + 63) / 64, 0);
+		std::vector<uint64_t> cand;
+		for (size_t b = 0; b < ranges.size(); ++b) {
+			size_t lo = ranges[b].first, hi = ranges[b].second;
+			// 同一个桶里 h2 相同的两个 key 无论 pilot 是多少都会冲突
+			for (size_t i = lo; i < hi; ++i)
+				for (size_t j = i + 1; j < hi; ++j)
+					if (h2[by_bucket[i].second] == h2[by_bucket[j].second])
+						return keys_[by_bucket[i].second] == keys_[by_bucket[j].second] ? -1 : 0;
+			uint32_t pilot = 0;
+			for (;; ++pilot) {
+				if (pilot == kMaxPilot) return 0;
+				cand.clear();
+				bool fit = true;
+				for (size_t i = lo; fit && i < hi; ++i) {
+					uint64_t p = position(h2[by_bucket[i].second], pilot, h.seed, h.table_size);
+					fit = !(taken[p / 64] >> (p % 64) & 1) && std::find(cand.begin(), cand.end(), p) == cand.end();
+					cand.push_back(p);
+				}
+				if (fit) break;
+			}
+			pilots[by_bucket[lo].first] = pilot;
+			for (size_t i = lo; i < hi; ++i) {
+				taken[cand[i - lo] / 64] |= 1ULL << (cand[i - lo] % 64);
+				pos[by_bucket[i].second] = cand[i - lo];
+			}
+		}
+		return 1;
+	}
+
+	static bool bigger_bucket(const std::pair<size_t, size_t> &a, const std::pair<size_t, size_t> &b) {
+		return a.second - a.first > b.second - b.first;
+	}
+
+	// 记录：uint32 key 长度、uint32 value 长度、key、value，按 8 字节对齐
+	uint64_t record_size(size_t i) const { return (8 + keys_[i].size() + values_[i].size() + 7) & ~static_cast<uint64_t>(7); }
+
+	bool write_record(FILE *fp, uint64_t off, size_t i) const {
+		uint32_t lens[2] = { static_cast<uint32_t>(keys_[i].size()), static_cast<uint32_t>(values_[i].size()) };
+		static const char zeros[8] = { 0 };
+		size_t pad = record_size(i) - 8 - lens[0] - lens[1];
+		return write_at(fp, off, lens, sizeof(lens)) && fwrite(keys_[i].data(), 1, lens[0], fp) == lens[0] &&
+			fwrite(values_[i].data(), 1, lens[1], fp) == lens[1] && fwrite(zeros, 1, pad, fp) == pad;
+	}
+
+	static bool write_at(FILE *fp, uint64_t off, const void *data, size_t len) {
+		if (fseeko(fp, static_cast<off_t>(off), SEEK_SET) != 0) return false;
+		return len == 0 || fwrite(data, 1, len, fp) == len;
+	}
+
+	std::vector<std::string> keys_;
+	std::vector<std::string> values_;
+};
+
+class mph_table {
+public:
+	mph_table() : base_(NULL), size_(0), h_(NULL) { }
+	~mph_table() { close(); }
+	mph_table(const mph_table &) = delete;
+	mph_table &operator=(const mph_table &) = delete;
+
+	// 映射整个文件；文件格式不对时返回 false，errno 为 EINVAL
+	bool open(const char *path) {
+		close();
+		int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			int saved = errno;
+			::close(fd);
+			errno = saved;
+			return false;
+		}
+		if (static_cast<size_t>(st.st_size) < sizeof(mph_detail::header)) {
+			::close(fd);
+			errno = EINVAL;
+			return false;
+		}
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		int saved = errno;
+		::close(fd);
+		if (p == MAP_FAILED) {
+			errno = saved;
+			return false;
+		}
+		madvise(p, st.st_size, MADV_WILLNEED);
+		base_ = static_cast<const char *>(p);
+		size_ = st.st_size;
+		h_ = reinterpret_cast<const mph_detail::header *>(base_);
+		if (!valid()) {
+			close();
+			errno = EINVAL;
+			return false;
+		}
+		pilots_ = reinterpret_cast<const uint32_t *>(base_ + h_->pilots_off);
+		bits_ = reinterpret_cast<const uint64_t *>(base_ + h_->bits_off);
+		offsets_ = reinterpret_cast<const uint64_t *>(base_ + h_->offsets_off);
+		return true;
+	}
+	void close() {
+		if (base_) munmap(const_cast<char *>(base_), size_);
+		base_ = NULL;
+		size_ = 0;
+		h_ = NULL;
+	}
+
+	size_t size() const { return h_ ? h_->count : 0; }
+
+	// 找到时 value 指向映射中的数据，在 close 之前一直有效
+	bool find(const void *key, size_t len, const char **value, size_t *value_len) const {
+		using namespace mph_detail;
+		if (!h_ || h_->count == 0) return false;
+		uint64_t a = hash1(key, len, h_->seed);
+		uint64_t p = position(hash2(a), pilots_[fastrange(a, h_->buckets)], h_->seed, h_->table_size);
+		if (!(bits_[p / 64 * 2] >> (p % 64) & 1)) return false;
+		const char *rec = base_ + offsets_[rank(bits_, p)];
+		uint32_t lens[2];
+		memcpy(lens, rec, sizeof(lens));
+		if (lens[0] != len || memcmp(rec + 8, key, len) != 0) return false;
+		*value = rec + 8 + lens[0];
+		*value_len = lens[1];
+		return true;
+	}
+	bool find(const std::string &key, std::string *value) const {
+		const char *v;
+		size_t n;
+		if (!find(key.data(), key.size(), &v, &n)) return false;
+		value->assign(v, n);
+		return true;
+	}
+	bool contains(const std::string &key) const {
+		const char *v;
+		size_t n;
+		return find(key.data(), key.size(), &v, &n);
+	}
+
+private:
+	// 检查文件头和各段范围；记录内容由构建方保证
+	bool valid() const {
+		using namespace mph_detail;
+		const header &h = *h_;
+		uint64_t words = (h.table_size + 63) / 64;
+		return memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.file_size == size_ &&
+			h.table_size >= h.count && h.buckets > 0 && h.table_size < (1ULL << 58) && h.buckets < (1ULL << 60) &&
+			h.pilots_off + h.buckets * sizeof(uint32_t) <= h.bits_off && h.bits_off % 8 == 0 &&
+			h.bits_off + 2 * words * sizeof(uint64_t) <= h.offsets_off && h.offsets_off % 8 == 0 &&
+			h.count < (1ULL << 58) && h.offsets_off + h.count * sizeof(uint64_t) <= h.data_off &&
+			h.data_off <= size_;
+	}
+
+	const char *base_;
+	size_t size_;
+	const mph_detail::header *h_;
+	const uint32_t *pilots_;
+	const uint64_t *bits_;
+	const uint64_t *offsets_;
+};
+
+#endif
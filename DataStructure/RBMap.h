@@ -0,0 +1,977 @@
+#ifndef RB_MAP_H
+#define RB_MAP_H
+
+// 红黑树实现的有序 map（RedBlackTree.cpp 中 bst 的通用版本）
+//
+// - 与 std::map 相同的接口子集：find / lower_bound / upper_bound / equal_range、
+//   双向迭代器、insert / emplace / try_emplace / operator[] / erase；
+// - 树结构使用头结点：header.parent 为根，header.left / header.right 为最小 / 最大结点，
+//   end() 就是头结点，--end() 得到最大元素；空孩子为 NULL，不需要 NIL 结点；
+// - 结点从每棵树自己的 arena 中分配：一次向 Alloc 申请一整块（最多约 1MB），
+//   删除的结点放进空闲链表复用，clear / 析构时整块释放；
+//   按插入顺序相邻的结点在内存中也相邻，不同的树不会互相打散；
+// - 批量操作：assign_sorted 由有序序列 O(N) 建树；join 连接两棵树，O(log N)；
+//   split 按 key 拆分，树结构的拆分 O(log N)，但结点不记录子树大小，
+//   两边的元素个数要数出较小的一边，总代价 O(log N + min(|L|, |R|))；
+//   set_union / set_intersection / set_difference 用 join、split 递归合并两棵树，
+//   O(m log(n / m + 1))（m ≤ n 为两棵树的大小），左右两半互不相交，可以多线程并行。
+//   这些操作直接搬动结点，不复制元素，内存块随结点转移到结果树。
+//
+// 插入、删除的平衡调整与 libstdc++ 的 _Rb_tree 相同，与 key 类型无关的部分放在 rb_detail 中；
+// join 的算法见 Blelloch 等人的 "Just Join for Parallel Ordered Sets"。
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rb_detail {
+
+struct node_base {
+	node_base *parent;
+	node_base *left;
+	node_base *right;
+	bool red;
+};
+
+inline node_base *minimum(node_base *x) {
+	while (x->left) x = x->left;
+	return x;
+}
+inline node_base *maximum(node_base *x) {
+	while (x->right) x = x->right;
+	return x;
+}
+
+// 中序后继；最大结点的后继是头结点
+inline node_base *increment(node_base *x) {
+	if (x->right) return minimum(x->right);
+	node_base *y = x->parent;
+	while (x == y->right) {
+		x = y;
+		y = y->parent;
+	}
+	// 只有根结点时 x 走到头结点，y 为根，此时 x 就是结果
+	return x->right != y ? y : x;
+}
+
+// 中序前驱；头结点（红色、祖父为自己）的前驱是最大结点
+inline node_base *decrement(node_base *x) {
+	if (x->red && x->parent->parent == x) return x->right;
+	if (x->left) return maximum(x->left);
+	node_base *y = x->parent;
+	while (x == y->left) {
+		x = y;
+		y = y->parent;
+	}
+	return y;
+}
+
+inline void rotate_left(node_base *x, node_base *&root) {
+	node_base *y = x->right;
+	x->right = y->left;
+	if (y->left) y->left->parent = x;
+	y->parent = x->parent;
+	if (x == root) root = y;
+	else if (x == x->parent->left) x->parent->left = y;
+	else x->parent->right = y;
+	y->left = x;
+	x->parent = y;
+}
+
+inline void rotate_right(node_base *x, node_base *&root) {
+	node_base *y = x->left;
+	x->left = y->right;
+	if (y->right) y->right->parent = x;
+	y->parent = x->parent;
+	if (x == root) root = y;
+	else if (x == x->parent->right) x->parent->right = y;
+	else x->parent->left = y;
+	y->right = x;
+	x->parent = y;
+}
+
+inline bool insert_fixup(node_base *x, node_base *&root);
+
+// 把新结点 x 挂到 p 的左边或右边，然后重新着色、旋转
+inline void insert_rebalance(bool insert_left, node_base *x, node_base *p, node_base &header) {
+	node_base *&root = header.parent;
+	x->parent = p;
+	x->left = x->right = NULL;
+	x->red = true;
+	if (insert_left) {
+		p->left = x;		// p 为头结点时 header.left 也设好了
+		if (p == &header) {
+			header.parent = x;
+			header.right = x;
+		} else if (p == header.left) {
+			header.left = x;
+		}
+	} else {
+		p->right = x;
+		if (p == header.right) header.right = x;
+	}
+	insert_fixup(x, root);
+}
+
+// 红色结点 x 与红色的父结点相邻时，向上重新着色、旋转，直到满足红黑性质。
+// root 必须是黑色（独立子树的根可以不在头结点下）。根被涂红后再涂黑时整棵树黑高加 1，此时返回 true
+inline bool insert_fixup(node_base *x, node_base *&root) {
+	while (x != root && x->parent->red) {
+		node_base *xpp = x->parent->parent;
+		if (x->parent == xpp->left) {
+			node_base *y = xpp->right;
+			if (y && y->red) {
+				x->parent->red = false;
+				y->red = false;
+				xpp->red = true;
+				x = xpp;
+			} else {
+				if (x == x->parent->right) {
+					x = x->parent;
+					rotate_left(x, root);
+				}
+				x->parent->red = false;
+				xpp->red = true;
+				rotate_right(xpp, root);
+			}
+		} else {
+			node_base *y = xpp->left;
+			if (y && y->red) {
+				x->parent->red = false;
+				y->red = false;
+				xpp->red = true;
+				x = xpp;
+			} else {
+				if (x == x->parent->left) {
+					x = x->parent;
+					rotate_right(x, root);
+				}
+				x->parent->red = false;
+				xpp->red = true;
+				rotate_left(xpp, root);
+			}
+		}
+	}
+	bool grew = root->red;
+	root->red = false;
+	return grew;
+}
+
+inline bool is_black(node_base *x) { return x == NULL || !x->red; }
+
+// 把 z 从树中摘下并恢复红黑性质，返回 z（调用方负责释放）
+inline node_base *erase_rebalance(node_base *z, node_base &header) {
+	node_base *&root = header.parent;
+	node_base *&leftmost = header.left;
+	node_base *&rightmost = header.right;
+	node_base *y = z;
+	node_base *x = NULL;
+	node_base *x_parent = NULL;
+
+	if (y->left == NULL) {
+		x = y->right;
+	} else if (y->right == NULL) {
+		x = y->left;
+	} else {
+		y = minimum(y->right);		// z 有两个孩子，y 为 z 的后继
+		x = y->right;
+	}
+	if (y != z) {
+		// 用 y 顶替 z 的位置
+		z->left->parent = y;
+		y->left = z->left;
+		if (y != z->right) {
+			x_parent = y->parent;
+			if (x) x->parent = y->parent;
+			y->parent->left = x;
+			y->right = z->right;
+			z->right->parent = y;
+		} else {
+			x_parent = y;
+		}
+		if (root == z) root = y;
+		else if (z->parent->left == z) z->parent->left = y;
+		else z->parent->right = y;
+		y->parent = z->parent;
+		std::swap(y->red, z->red);
+		y = z;		// y 现在指向真正被删除的结点
+	} else {
+		x_parent = y->parent;
+		if (x) x->parent = y->parent;
+		if (root == z) root = x;
+		else if (z->parent->left == z) z->parent->left = x;
+		else z->parent->right = x;
+		if (leftmost == z) leftmost = z->right == NULL ? z->parent : minimum(x);
+		if (rightmost == z) rightmost = z->left == NULL ? z->parent : maximum(x);
+	}
+
+	if (!y->red) {
+		// 删掉了一个黑结点，x 所在的路径少了一个黑结点
+		while (x != root && is_black(x)) {
+			if (x == x_parent->left) {
+				node_base *w = x_parent->right;
+				if (w->red) {
+					w->red = false;
+					x_parent->red = true;
+					rotate_left(x_parent, root);
+					w = x_parent->right;
+				}
+				if (is_black(w->left) && is_black(w->right)) {
+					w->red = true;
+					x = x_parent;
+					x_parent = x_parent->parent;
+				} else {
+					if (is_black(w->right)) {
+						w->left->red = false;
+						w->red = true;
+						rotate_right(w, root);
+						w = x_parent->right;
+					}
+					w->red = x_parent->red;
+					x_parent->red = false;
+					if (w->right) w->right->red = false;
+					rotate_left(x_parent, root);
+					break;
+				}
+			} else {
+				node_base *w = x_parent->left;
+				if (w->red) {
+					w->red = false;
+					x_parent->red = true;
+					rotate_right(x_parent, root);
+					w = x_parent->left;
+				}
+				if (is_black(w->right) && is_black(w->left)) {
+					w->red = true;
+					x = x_parent;
+					x_parent = x_parent->parent;
+				} else {
+					if (is_black(w->left)) {
+						w->right->red = false;
+						w->red = true;
+						rotate_left(w, root);
+						w = x_parent->left;
+					}
+					w->red = x_parent->red;
+					x_parent->red = false;
+					if (w->left) w->left->red = false;
+					rotate_right(x_parent, root);
+					break;
+				}
+			}
+		}
+		if (x) x->red = false;
+	}
+	return y;
+}
+
+// 从树中拆下的独立子树：根可以是红色，black_height 为从根（含）到空孩子路径上的黑结点数，
+// 根的 parent 指针没有意义
+struct subtree {
+	node_base *root;
+	int black_height;
+};
+
+inline subtree make_subtree(node_base *root, int black_height) {
+	subtree t = { root, black_height };
+	return t;
+}
+
+inline int black_height(const node_base *x) {
+	int h = 0;
+	for (; x; x = x->left) h += !x->red;
+	return h;
+}
+
+inline void attach(node_base *k, node_base *l, node_base *r) {
+	k->left = l;
+	k->right = r;
+	if (l) l->parent = k;
+	if (r) r->parent = k;
+}
+
+// 连接：l 中的 key 都小于 k，r 中的 key 都大于 k，O(|黑高差| + 1)。
+// 先把两边的根涂黑；黑高相同时 k 作为红色的新根，否则沿较高一侧的右（左）边界下降到
+// 黑高与另一侧相同的黑结点 x，用红色的 k 顶替 x、以 x 和另一侧为孩子，再按插入修复红红冲突
+inline subtree join(subtree l, node_base *k, subtree r) {
+	if (l.root && l.root->red) {
+		l.root->red = false;
+		++l.black_height;
+	}
+	if (r.root && r.root->red) {
+		r.root->red = false;
+		++r.black_height;
+	}
+	k->red = true;
+	if (l.black_height == r.black_height) {
+		attach(k, l.root, r.root);
+		return make_subtree(k, l.black_height);
+	}
+	bool right_spine = l.black_height > r.black_height;
+	subtree &tall = right_spine ? l : r;
+	const subtree &low = right_spine ? r : l;
+	node_base *root = tall.root, *p = NULL, *x = root;
+	int h = tall.black_height;
+	while (x && (x->red || h > low.black_height)) {
+		h -= !x->red;
+		p = x;
+		x = right_spine ? x->right : x->left;
+	}
+	if (right_spine) {
+		attach(k, x, low.root);
+		p->right = k;
+	} else {
+		attach(k, low.root, x);
+		p->left = k;
+	}
+	k->parent = p;
+	bool grew = insert_fixup(k, root);
+	return make_subtree(root, tall.black_height + grew);
+}
+
+// 按块分配结点的 arena：只负责内存，结点中的值由调用方构造、析构。
+// 内存块放在引用计数的 pool 中：split 后两棵树的结点混在同一批块里，两边都持有这些 pool，
+// 最后一个持有者释放时才归还给 Alloc；新结点总是从自己的 pool 分配
+template <class Node, class Alloc>
+class arena {
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Node> node_alloc;
+	typedef std::allocator_traits<node_alloc> traits;
+	static const size_t kFirstBlock = 16;
+	static const size_t kMaxBlock = (1 << 20) / sizeof(Node) > kFirstBlock ? (1 << 20) / sizeof(Node) : kFirstBlock;
+
+	struct pool {
+		explicit pool(const node_alloc &a) : alloc(a) { }
+		~pool() {
+			for (size_t i = 0; i < blocks.size(); ++i) traits::deallocate(alloc, blocks[i].first, blocks[i].second);
+		}
+		node_alloc alloc;
+		std::vector<std::pair<Node *, size_t> > blocks;
+	};
+public:
+	explicit arena(const Alloc &alloc) : alloc_(alloc), free_(NULL), next_(NULL), end_(NULL), block_(kFirstBlock) { }
+	~arena() { release(); }
+	arena(const arena &) = delete;
+	arena &operator=(const arena &) = delete;
+
+	Node *allocate() {
+		if (free_) {
+			Node *n = free_;
+			free_ = static_cast<Node *>(n->parent);
+			return n;
+		}
+		if (next_ == end_) grow();
+		return next_++;
+	}
+	// 空闲链表借用结点的 parent 指针
+	void deallocate(Node *n) {
+		n->parent = free_;
+		free_ = n;
+	}
+	void release() {
+		own_.reset();
+		shared_.clear();
+		free_ = next_ = end_ = NULL;
+		block_ = kFirstBlock;
+	}
+	void swap(arena &other) {
+		std::swap(alloc_, other.alloc_);
+		own_.swap(other.own_);
+		shared_.swap(other.shared_);
+		std::swap(free_, other.free_);
+		std::swap(next_, other.next_);
+		std::swap(end_, other.end_);
+		std::swap(block_, other.block_);
+	}
+	// 同时持有 other 的全部内存块（other 的一部分结点将属于本 arena 的树）。
+	// other 之后申请的新块放进新的 pool，不会被本 arena 拖住
+	void share(arena &other) {
+		if (other.own_) {
+			other.shared_.push_back(other.own_);
+			other.own_.reset();
+		}
+		for (size_t i = 0; i < other.shared_.size(); ++i) hold(other.shared_[i]);
+	}
+	// 接管 other 的全部内存块和空闲结点，other 变为空
+	void adopt(arena &other) {
+		share(other);
+		while (other.free_) {
+			Node *n = other.free_;
+			other.free_ = static_cast<Node *>(n->parent);
+			deallocate(n);
+		}
+		other.release();
+	}
+	const node_alloc &allocator() const { return alloc_; }
+	// 持有的内存块的字节数（与其它树共享的块两边都计入）
+	size_t bytes() const {
+		size_t n = own_ ? pool_bytes(*own_) : 0;
+		for (size_t i = 0; i < shared_.size(); ++i) n += pool_bytes(*shared_[i]);
+		return n;
+	}
+
+private:
+	static size_t pool_bytes(const pool &p) {
+		size_t n = 0;
+		for (size_t i = 0; i < p.blocks.size(); ++i) n += p.blocks[i].second * sizeof(Node);
+		return n;
+	}
+	void hold(const std::shared_ptr<pool> &p) {
+		if (p == own_) return;
+		for (size_t i = 0; i < shared_.size(); ++i)
+			if (shared_[i] == p) return;
+		shared_.push_back(p);
+	}
+	// 每块是上一块的 2 倍，直到 kMaxBlock
+	void grow() {
+		if (!own_) own_ = std::make_shared<pool>(alloc_);
+		next_ = traits::allocate(alloc_, block_);
+		end_ = next_ + block_;
+		own_->blocks.push_back(std::make_pair(next_, block_));
+		if (block_ < kMaxBlock) block_ = block_ * 2 < kMaxBlock ? block_ * 2 : kMaxBlock;
+	}
+
+	node_alloc alloc_;
+	std::shared_ptr<pool> own_;						// 本 arena 分配新块的 pool
+	std::vector<std::shared_ptr<pool> > shared_;	// split / join 后与其它树共享或接管的 pool
+	Node *free_;
+	Node *next_;
+	Node *end_;
+	size_t block_;
+};
+
+}  // namespace rb_detail
+
+template <class K, class V, class Compare = std::less<K>, class Alloc = std::allocator<std::pair<const K, V> > >
+class rb_map {
+	typedef rb_detail::node_base node_base;
+	struct node : node_base {
+		std::pair<const K, V> value;
+	};
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef Compare key_compare;
+	typedef Alloc allocator_type;
+	typedef size_t size_type;
+
+	template <bool Const>
+	class iter {
+		friend class rb_map;
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef std::pair<const K, V> value_type;
+		typedef typename std::conditional<Const, const value_type, value_type>::type element;
+		typedef ptrdiff_t difference_type;
+		typedef element *pointer;
+		typedef element &reference;
+
+		iter() : node_(NULL) { }
+		// 普通迭代器可以转换为 const 迭代器
+		template <bool OtherConst, class = typename std::enable_if<Const && !OtherConst>::type>
+		iter(const iter<OtherConst> &other) : node_(other.node_) { }
+		element &operator*() const { return static_cast<node *>(node_)->value; }
+		element *operator->() const { return &static_cast<node *>(node_)->value; }
+		iter &operator++() { node_ = rb_detail::increment(node_); return *this; }
+		iter operator++(int) { iter tmp = *this; ++*this; return tmp; }
+		iter &operator--() { node_ = rb_detail::decrement(node_); return *this; }
+		iter operator--(int) { iter tmp = *this; --*this; return tmp; }
+	private:
+		friend class iter<!Const>;
+		explicit iter(const node_base *n) : node_(const_cast<node_base *>(n)) { }
+		node_base *node_;
+	};
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	// 非成员函数，两边都转换为 const_iterator，iterator 与 const_iterator 可以互相比较；
+	// iter 是 rb_map 的嵌套类，通过 ADL 可以找到这里的友元
+	friend bool operator==(const const_iterator &a, const const_iterator &b) { return node_of(a) == node_of(b); }
+	friend bool operator!=(const const_iterator &a, const const_iterator &b) { return node_of(a) != node_of(b); }
+
+	explicit rb_map(const Compare &comp = Compare(), const Alloc &alloc = Alloc())
+		: comp_(comp), arena_(alloc), size_(0) {
+		reset_header();
+	}
+	rb_map(const rb_map &other) : comp_(other.comp_), arena_(other.get_allocator()), size_(0) {
+		reset_header();
+		// 按顺序插入，每次都挂在最大结点右边（空树时挂在头结点左边），不需要比较
+		// 中途抛出异常时析构函数不会执行，已经构造的元素要在这里析构，内存由 arena 释放
+		try {
+			for (const_iterator it = other.begin(); it != other.end(); ++it) link(create(*it), header_.right, size_ == 0);
+		} catch (...) {
+			destroy_values();
+			throw;
+		}
+	}
+	rb_map(rb_map &&other) : comp_(other.comp_), arena_(other.get_allocator()), size_(0) {
+		reset_header();
+		swap(other);
+	}
+	rb_map &operator=(rb_map other) { swap(other); return *this; }
+	~rb_map() { destroy_values(); }
+
+	// 头结点中的指针指向自己，交换后要修正
+	void swap(rb_map &other) {
+		std::swap(comp_, other.comp_);
+		arena_.swap(other.arena_);
+		std::swap(size_, other.size_);
+		std::swap(header_, other.header_);
+		fix_header();
+		other.fix_header();
+	}
+
+	iterator begin() { return iterator(header_.left); }
+	iterator end() { return iterator(&header_); }
+	const_iterator begin() const { return const_iterator(header_.left); }
+	const_iterator end() const { return const_iterator(&header_); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	// arena 占用的字节数
+	size_t memory_usage() const { return arena_.bytes(); }
+
+	void clear() {
+		destroy_values();
+		arena_.release();
+		size_ = 0;
+		reset_header();
+	}
+
+	iterator find(const K &key) { return iterator(find_node(key)); }
+	const_iterator find(const K &key) const { return const_iterator(find_node(key)); }
+	size_t count(const K &key) const { return find_node(key) != &header_; }
+	bool contains(const K &key) const { return find_node(key) != &header_; }
+
+	// 第一个不小于 key 的元素
+	iterator lower_bound(const K &key) { return iterator(lower_bound_node(key)); }
+	const_iterator lower_bound(const K &key) const { return const_iterator(lower_bound_node(key)); }
+	// 第一个大于 key 的元素
+	iterator upper_bound(const K &key) { return iterator(upper_bound_node(key)); }
+	const_iterator upper_bound(const K &key) const { return const_iterator(upper_bound_node(key)); }
+	std::pair<iterator, iterator> equal_range(const K &key) {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+	std::pair<const_iterator, const_iterator> equal_range(const K &key) const {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+
+	V &at(const K &key) {
+		node_base *n = find_node(key);
+		if (n == &header_) throw std::out_of_range("rb_map::at");
+		return static_cast<node *>(n)->value.second;
+	}
+	const V &at(const K &key) const {
+		const node_base *n = find_node(key);
+		if (n == &header_) throw std::out_of_range("rb_map::at");
+		return static_cast<const node *>(n)->value.second;
+	}
+
+	V &operator[](const K &key) { return try_emplace(key).first->second; }
+
+	std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(const K &key, Args &&... args) {
+		bool left;
+		node_base *existing;
+		node_base *parent = insert_position(key, &left, &existing);
+		if (!parent) return std::make_pair(iterator(existing), false);
+		node *n = create(std::piecewise_construct, std::forward_as_tuple(key),
+						 std::forward_as_tuple(std::forward<Args>(args)...));
+		link(n, parent, left);
+		return std::make_pair(iterator(n), true);
+	}
+
+	template <class... Args>
+	std::pair<iterator, bool> emplace(Args &&... args) {
+		node *n = create(std::forward<Args>(args)...);
+		bool left;
+		node_base *existing;
+		node_base *parent = insert_position(n->value.first, &left, &existing);
+		if (!parent) {
+			free_node(n);
+			return std::make_pair(iterator(existing), false);
+		}
+		link(n, parent, left);
+		return std::make_pair(iterator(n), true);
+	}
+
+	size_t erase(const K &key) {
+		node_base *n = find_node(key);
+		if (n == &header_) return 0;
+		erase_node(n);
+		return 1;
+	}
+	// 返回下一个元素的迭代器
+	iterator erase(const_iterator pos) {
+		node_base *next = rb_detail::increment(pos.node_);
+		erase_node(pos.node_);
+		return iterator(next);
+	}
+	iterator erase(const_iterator first, const_iterator last) {
+		if (first == begin() && last == end()) {
+			clear();
+			return end();
+		}
+		while (first != last) first = erase(first);
+		return iterator(last.node_);
+	}
+
+	// 用严格递增的序列 [first, last) 替换全部内容，O(N)：
+	// 按中序依次创建结点（内存中也按 key 的顺序排列），再按中点递归连成完全平衡的树，
+	// 只有最下面不满的一层是红色
+	template <class ForwardIt>
+	void assign_sorted(ForwardIt first, ForwardIt last) {
+		clear();
+		std::vector<node_base *> nodes;
+		nodes.reserve(std::distance(first, last));
+		try {
+			for (; first != last; ++first) nodes.push_back(create(*first));
+		} catch (...) {
+			for (size_t i = 0; i < nodes.size(); ++i) free_node(static_cast<node *>(nodes[i]));
+			throw;
+		}
+		if (nodes.empty()) return;
+		int full = 0;		// 满的层数
+		while ((static_cast<size_t>(2) << full) - 1 <= nodes.size()) ++full;
+		set_root(rb_detail::make_subtree(build(&nodes[0], nodes.size(), 0, full), full));
+		size_ = nodes.size();
+	}
+
+	// greater 中的 key 必须都大于本树中的 key；把 greater 的全部元素移入本树，greater 变为空
+	void join(rb_map &greater) {
+		if (&greater == this || greater.empty()) return;
+		arena_.adopt(greater.arena_);
+		size_t total = size_ + greater.size_;
+		// 取出 greater 的最小结点作为连接点
+		rb_detail::subtree l, r, dummy;
+		node_base *mid;
+		split_tree(greater.whole(), key_of(greater.header_.left), &dummy, &mid, &r);
+		l = whole();
+		greater.reset_header();
+		greater.size_ = 0;
+		set_root(rb_detail::join(l, mid, r));
+		size_ = total;
+	}
+
+	// 把不小于 key 的元素移到 greater（greater 原有的元素被清空）。
+	// 总代价 O(log N + min(|L|, |R|))，不是 O(log N)：树结构的拆分是 O(log N)，
+	// 但结点不记录子树大小，size() 要同时遍历两棵树数出较小的一边。
+	// 此后两棵树共享已申请的内存块，直到两边都释放
+	void split(const K &key, rb_map &greater) {
+		if (&greater == this) return;
+		greater.clear();
+		size_t total = size_;
+		rb_detail::subtree l, r;
+		node_base *mid;
+		split_tree(whole(), key, &l, &mid, &r);
+		if (mid) r = rb_detail::join(rb_detail::make_subtree(NULL, 0), mid, r);
+		set_root(l);
+		greater.set_root(r);
+		greater.arena_.share(arena_);
+		const_iterator a = begin(), b = greater.begin();
+		size_t n = 0;
+		for (; a != end() && b != greater.end(); ++a, ++b) ++n;
+		size_ = a == end() ? n : total - n;
+		greater.size_ = total - size_;
+	}
+
+	// 与 other 求并集 / 交集 / 差集，结果留在本树，other 变为空；两边都有的 key 保留本树的 value。
+	// threads > 1 时递归的前 log2(threads) 层把左右两半交给不同线程
+	void set_union(rb_map &other, unsigned threads = 1) { combine(other, threads, &rb_map::unite); }
+	void set_intersection(rb_map &other, unsigned threads = 1) { combine(other, threads, &rb_map::intersect); }
+	void set_difference(rb_map &other, unsigned threads = 1) { combine(other, threads, &rb_map::subtract); }
+
+	key_compare key_comp() const { return comp_; }
+	allocator_type get_allocator() const { return allocator_type(arena_.allocator()); }
+
+private:
+	typedef rb_detail::subtree subtree;
+	typedef subtree (rb_map::*set_op)(subtree, subtree, int, std::vector<node_base *> &) const;
+
+	static const K &key_of(const node_base *n) { return static_cast<const node *>(n)->value.first; }
+
+	void reset_header() {
+		header_.red = true;		// 用于 decrement 区分头结点
+		header_.parent = NULL;
+		header_.left = header_.right = &header_;
+	}
+	void fix_header() {
+		if (header_.parent) {
+			header_.parent->parent = &header_;
+		} else {
+			header_.left = header_.right = &header_;
+		}
+	}
+
+	template <class... Args>
+	node *create(Args &&... args) {
+		node *n = arena_.allocate();
+		try {
+			new (&n->value) value_type(std::forward<Args>(args)...);
+		} catch (...) {
+			arena_.deallocate(n);
+			throw;
+		}
+		return n;
+	}
+	static const node_base *node_of(const const_iterator &it) { return it.node_; }
+	void free_node(node *n) {
+		n->value.~value_type();
+		arena_.deallocate(n);
+	}
+
+	void destroy_values() {
+		if (std::is_trivially_destructible<value_type>::value) return;
+		for (node_base *n = header_.left; n != &header_; n = rb_detail::increment(n))
+			static_cast<node *>(n)->value.~value_type();
+	}
+
+	node_base *lower_bound_node(const K &key) const {
+		const node_base *y = &header_;
+		const node_base *x = header_.parent;
+		while (x) {
+			if (!comp_(key_of(x), key)) {
+				y = x;
+				x = x->left;
+			} else {
+				x = x->right;
+			}
+		}
+		return const_cast<node_base *>(y);
+	}
+	node_base *upper_bound_node(const K &key) const {
+		const node_base *y = &header_;
+		const node_base *x = header_.parent;
+		while (x) {
+			if (comp_(key, key_of(x))) {
+				y = x;
+				x = x->left;
+			} else {
+				x = x->right;
+			}
+		}
+		return const_cast<node_base *>(y);
+	}
+	node_base *find_node(const K &key) const {
+		node_base *n = lower_bound_node(key);
+		return n == &header_ || comp_(key, key_of(n)) ? const_cast<node_base *>(&header_) : n;
+	}
+
+	// 新结点应挂在返回的结点下（left 表示左边）；key 已存在时返回 NULL，existing 为已有结点
+	node_base *insert_position(const K &key, bool *left, node_base **existing) {
+		node_base *y = &header_;
+		node_base *x = header_.parent;
+		bool go_left = true;
+		while (x) {
+			y = x;
+			go_left = comp_(key, key_of(x));
+			x = go_left ? x->left : x->right;
+		}
+		// y 为插入位置的父结点，前驱为 y（右插）或 y 的前驱（左插）
+		node_base *pred = y;
+		if (go_left) {
+			if (y == header_.left) {
+				*left = true;
+				return y;
+			}
+			pred = rb_detail::decrement(y);
+		}
+		if (comp_(key_of(pred), key)) {
+			*left = go_left;
+			return y;
+		}
+		*existing = pred;
+		return NULL;
+	}
+
+	void link(node *n, node_base *parent, bool left) {
+		rb_detail::insert_rebalance(left, n, parent, header_);
+		++size_;
+	}
+
+	void erase_node(node_base *n) {
+		rb_detail::erase_rebalance(n, header_);
+		free_node(static_cast<node *>(n));
+		--size_;
+	}
+
+	// 把有序结点数组 nodes[0, n) 连成平衡树，深度不小于 full 的结点为红色
+	static node_base *build(node_base **nodes, size_t n, int depth, int full) {
+		if (n == 0) return NULL;
+		size_t mid = n / 2;
+		node_base *x = nodes[mid];
+		rb_detail::attach(x, build(nodes, mid, depth + 1, full), build(nodes + mid + 1, n - mid - 1, depth + 1, full));
+		x->red = depth >= full;
+		return x;
+	}
+
+	// 整棵树作为独立子树
+	subtree whole() const { return rb_detail::make_subtree(header_.parent, rb_detail::black_height(header_.parent)); }
+	// 以子树 t 作为整棵树的内容（size_ 由调用方设置）
+	void set_root(subtree t) {
+		if (!t.root) {
+			reset_header();
+			return;
+		}
+		header_.parent = t.root;
+		t.root->parent = &header_;
+		t.root->red = false;
+		header_.left = rb_detail::minimum(t.root);
+		header_.right = rb_detail::maximum(t.root);
+	}
+
+	// 把子树 t 拆成小于 key 的 l、等于 key 的结点 mid（没有时为 NULL）和大于 key 的 r。
+	// 沿查找路径下降，回溯时把路径上每个结点与另一侧的孩子 join 起来，总代价 O(log N)
+	void split_tree(subtree t, const K &key, subtree *l, node_base **mid, subtree *r) const {
+		if (!t.root) {
+			*l = *r = t;
+			*mid = NULL;
+			return;
+		}
+		node_base *x = t.root;
+		int h = t.black_height - !x->red;
+		subtree left = rb_detail::make_subtree(x->left, h), right = rb_detail::make_subtree(x->right, h);
+		if (comp_(key, key_of(x))) {
+			split_tree(left, key, l, mid, &left);
+			*r = rb_detail::join(left, x, right);
+		} else if (comp_(key_of(x), key)) {
+			split_tree(right, key, &right, mid, r);
+			*l = rb_detail::join(left, x, right);
+		} else {
+			*l = left;
+			*mid = x;
+			*r = right;
+		}
+	}
+
+	// 连接两棵没有中间结点的树：取出 l 的最大结点作为连接点
+	subtree join2(subtree l, subtree r) const {
+		if (!l.root) return r;
+		if (!r.root) return l;
+		node_base *mid;
+		subtree dummy;
+		split_tree(l, key_of(rb_detail::maximum(l.root)), &l, &mid, &dummy);
+		return rb_detail::join(l, mid, r);
+	}
+
+	// 子树的全部结点放进 garbage
+	static void collect(node_base *x, std::vector<node_base *> &garbage) {
+		if (!x) return;
+		size_t from = garbage.size();
+		garbage.push_back(x);
+		for (size_t i = from; i < garbage.size(); ++i) {
+			if (garbage[i]->left) garbage.push_back(garbage[i]->left);
+			if (garbage[i]->right) garbage.push_back(garbage[i]->right);
+		}
+	}
+
+	// 对 (a1, b1)、(a2, b2) 两对子树分别执行 op；depth 小于 parallel_depth_ 时第一对交给另一个线程
+	void recurse(set_op op, subtree a1, subtree b1, subtree a2, subtree b2, int depth, subtree *r1, subtree *r2,
+				 std::vector<node_base *> &garbage) const {
+		if (depth < parallel_depth_) {
+			std::vector<node_base *> other_garbage;
+			std::future<subtree> f = std::async(std::launch::async, [&]() {
+				return (this->*op)(a1, b1, depth + 1, other_garbage);
+			});
+			*r2 = (this->*op)(a2, b2, depth + 1, garbage);
+			*r1 = f.get();
+			garbage.insert(garbage.end(), other_garbage.begin(), other_garbage.end());
+		} else {
+			*r1 = (this->*op)(a1, b1, depth + 1, garbage);
+			*r2 = (this->*op)(a2, b2, depth + 1, garbage);
+		}
+	}
+
+	// 以 a 的根把 b 拆开，左右两半分别合并后再与根 join
+	subtree unite(subtree a, subtree b, int depth, std::vector<node_base *> &garbage) const {
+		if (!a.root) return b;
+		if (!b.root) return a;
+		node_base *k = a.root;
+		int h = a.black_height - !k->red;
+		subtree bl, br, l, r;
+		node_base *dup;
+		split_tree(b, key_of(k), &bl, &dup, &br);
+		if (dup) garbage.push_back(dup);
+		recurse(&rb_map::unite, rb_detail::make_subtree(k->left, h), bl, rb_detail::make_subtree(k->right, h), br,
+				depth, &l, &r, garbage);
+		return rb_detail::join(l, k, r);
+	}
+
+	subtree intersect(subtree a, subtree b, int depth, std::vector<node_base *> &garbage) const {
+		if (!a.root || !b.root) {
+			collect(a.root, garbage);
+			collect(b.root, garbage);
+			return rb_detail::make_subtree(NULL, 0);
+		}
+		node_base *k = a.root;
+		int h = a.black_height - !k->red;
+		subtree bl, br, l, r;
+		node_base *dup;
+		split_tree(b, key_of(k), &bl, &dup, &br);
+		recurse(&rb_map::intersect, rb_detail::make_subtree(k->left, h), bl, rb_detail::make_subtree(k->right, h), br,
+				depth, &l, &r, garbage);
+		if (dup) {
+			garbage.push_back(dup);
+			return rb_detail::join(l, k, r);
+		}
+		garbage.push_back(k);
+		return join2(l, r);
+	}
+
+	// a 中去掉 b 的 key：以 b 的根把 a 拆开
+	subtree subtract(subtree a, subtree b, int depth, std::vector<node_base *> &garbage) const {
+		if (!a.root || !b.root) {
+			collect(b.root, garbage);
+			return a;
+		}
+		node_base *k = b.root;
+		int h = b.black_height - !k->red;
+		subtree al, ar, l, r;
+		node_base *dup;
+		split_tree(a, key_of(k), &al, &dup, &ar);
+		garbage.push_back(k);
+		if (dup) garbage.push_back(dup);
+		recurse(&rb_map::subtract, al, rb_detail::make_subtree(k->left, h), ar, rb_detail::make_subtree(k->right, h),
+				depth, &l, &r, garbage);
+		return join2(l, r);
+	}
+
+	void combine(rb_map &other, unsigned threads, set_op op) {
+		if (&other == this) return;
+		arena_.adopt(other.arena_);
+		size_t total = size_ + other.size_;
+		subtree a = whole(), b = other.whole();
+		other.reset_header();
+		other.size_ = 0;
+		parallel_depth_ = 0;
+		while ((1u << parallel_depth_) < threads) ++parallel_depth_;
+		std::vector<node_base *> garbage;
+		set_root((this->*op)(a, b, 0, garbage));
+		for (size_t i = 0; i < garbage.size(); ++i) free_node(static_cast<node *>(garbage[i]));
+		size_ = total - garbage.size();
+	}
+
+	Compare comp_;
+	rb_detail::arena<node, Alloc> arena_;
+	node_base header_;
+	size_t size_;
+	int parallel_depth_ = 0;	// 集合运算中并行的递归层数
+};
+
+#endif
@@ -0,0 +1,87 @@
+// rb_map 与 std::map 的性能对比（64 位随机整数 key）
+//
+// 测试随机插入、命中查找、范围扫描（lower_bound 后顺序访问 100 个元素）、完整遍历和删除一半，
+// 输出每次操作（范围扫描为每个元素）的平均纳秒数。
+//
+// 编译：g++ -std=c++11 -O2 RBMapBench.cpp -o RBMapBench
+// 用法：./RBMapBench [元素个数,...]，默认 100000,1000000,10000000
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "RBMap.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kScanLength = 100;
+
+static uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static double ns_per_op(Clock::time_point start, size_t ops) {
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+template <class Map>
+static void run(const char *name, const std::vector<uint64_t> &keys) {
+	size_t n = keys.size(), scans = n / 10 + 1;
+	uint64_t sum = 0;
+	Map *map = new Map();
+
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < n; ++i) (*map)[keys[i]] = i;
+	double insert = ns_per_op(start, n);
+
+	start = Clock::now();
+	for (size_t i = 0; i < n; ++i) sum += map->find(keys[i])->second;
+	double hit = ns_per_op(start, n);
+
+	start = Clock::now();
+	for (size_t i = 0; i < scans; ++i) {
+		typename Map::const_iterator it = map->lower_bound(keys[i]);
+		for (size_t j = 0; j < kScanLength && it != map->end(); ++j, ++it) sum += it->second;
+	}
+	double scan = ns_per_op(start, scans * kScanLength);
+
+	start = Clock::now();
+	for (typename Map::const_iterator it = map->begin(); it != map->end(); ++it) sum += it->first;
+	double walk = ns_per_op(start, n);
+
+	start = Clock::now();
+	for (size_t i = 0; i < n; i += 2) sum += map->erase(keys[i]);
+	double erase = ns_per_op(start, n / 2);
+
+	printf("%-10s %12zu %10.1f %10.1f %10.1f %10.1f %10.1f   (checksum %llu)\n", name, n, insert, hit, scan, walk,
+		   erase, static_cast<unsigned long long>(sum));
+	delete map;
+}
+
+int main(int argc, char *argv[]) {
+	std::vector<size_t> sizes;
+	if (argc > 1) {
+		for (char *tok = strtok(argv[1], ","); tok != NULL; tok = strtok(NULL, ","))
+			sizes.push_back(strtoull(tok, NULL, 10));
+	} else {
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+		sizes.push_back(10000000);
+	}
+
+	printf("%-10s %12s %10s %10s %10s %10s %10s\n", "map", "keys", "insert", "find", "scan/elem", "walk/elem", "erase");
+	for (size_t s = 0; s < sizes.size(); ++s) {
+		std::vector<uint64_t> keys(sizes[s]);
+		uint64_t state = 1;
+		for (size_t i = 0; i < sizes[s]; ++i) keys[i] = splitmix64(state);
+		run<rb_map<uint64_t, uint64_t> >("rb_map", keys);
+		run<std::map<uint64_t, uint64_t> >("std::map", keys);
+	}
+	return 0;
+}
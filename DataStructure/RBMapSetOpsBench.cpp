@@ -0,0 +1,114 @@
+// rb_map 批量操作的性能测试
+//
+// - 建树：N 个有序 key 逐个 insert vs assign_sorted；
+// - 集合运算：两棵各 N 个随机 key 的树（约一半 key 相同），逐个插入 / 删除 vs
+//   set_union / set_intersection / set_difference（1 个和多个线程）。
+// 输出毫秒数；集合运算会消耗两棵输入树，每次计时前重新建树（不计入时间）。
+//
+// 编译：g++ -std=c++11 -O2 RBMapSetOpsBench.cpp -o RBMapSetOpsBench -pthread
+// 用法：./RBMapSetOpsBench [N] [线程数,...]，默认 1000000 1,2,4,8
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "RBMap.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef rb_map<uint64_t, uint64_t> map_t;
+typedef std::vector<std::pair<uint64_t, uint64_t> > items_t;
+
+static uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static double ms_since(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// n 个不重复的有序 key，取自 [0, 2n)
+static items_t make_items(size_t n, uint64_t seed) {
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; ++i) keys[i] = splitmix64(seed) % (2 * n);
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	items_t items;
+	for (size_t i = 0; i < keys.size(); ++i) items.push_back(std::make_pair(keys[i], i));
+	return items;
+}
+
+enum op_kind { kUnion, kIntersection, kDifference };
+
+// 逐个元素操作的基准
+static double naive(op_kind op, const items_t &x, const items_t &y, size_t *result) {
+	map_t a, b;
+	a.assign_sorted(x.begin(), x.end());
+	b.assign_sorted(y.begin(), y.end());
+	Clock::time_point start = Clock::now();
+	if (op == kUnion) {
+		for (map_t::const_iterator it = b.begin(); it != b.end(); ++it) a.insert(*it);
+	} else if (op == kIntersection) {
+		for (map_t::iterator it = a.begin(); it != a.end();) it = b.contains(it->first) ? ++it : a.erase(it);
+	} else {
+		for (map_t::const_iterator it = b.begin(); it != b.end(); ++it) a.erase(it->first);
+	}
+	double ms = ms_since(start);
+	*result = a.size();
+	return ms;
+}
+
+static double bulk(op_kind op, const items_t &x, const items_t &y, unsigned threads, size_t *result) {
+	map_t a, b;
+	a.assign_sorted(x.begin(), x.end());
+	b.assign_sorted(y.begin(), y.end());
+	Clock::time_point start = Clock::now();
+	if (op == kUnion) a.set_union(b, threads);
+	else if (op == kIntersection) a.set_intersection(b, threads);
+	else a.set_difference(b, threads);
+	double ms = ms_since(start);
+	*result = a.size();
+	return ms;
+}
+
+int main(int argc, char *argv[]) {
+	size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+	std::vector<unsigned> threads;
+	if (argc > 2) {
+		for (char *tok = strtok(argv[2], ","); tok != NULL; tok = strtok(NULL, ","))
+			threads.push_back(atoi(tok));
+	} else {
+		for (unsigned t = 1; t <= 8; t *= 2) threads.push_back(t);
+	}
+
+	items_t x = make_items(n, 1), y = make_items(n, 2);
+	printf("%zu / %zu keys\n", x.size(), y.size());
+
+	{
+		map_t a, b;
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < x.size(); ++i) a.insert(x[i]);
+		double insert = ms_since(start);
+		start = Clock::now();
+		b.assign_sorted(x.begin(), x.end());
+		double sorted = ms_since(start);
+		printf("%-16s %10s %12.1f ms\n%-16s %10s %12.1f ms\n", "build", "insert", insert, "", "sorted", sorted);
+	}
+
+	const char *names[] = { "union", "intersection", "difference" };
+	for (int op = kUnion; op <= kDifference; ++op) {
+		size_t r1, r2;
+		double t = naive(static_cast<op_kind>(op), x, y, &r1);
+		printf("%-16s %10s %12.1f ms   (%zu keys)\n", names[op], "per-key", t, r1);
+		for (size_t i = 0; i < threads.size(); ++i) {
+			t = bulk(static_cast<op_kind>(op), x, y, threads[i], &r2);
+			printf("%-16s %7u th %12.1f ms%s\n", "", threads[i], t, r1 == r2 ? "" : "   MISMATCH");
+		}
+	}
+	return 0;
+}
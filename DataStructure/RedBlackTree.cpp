@@ -1,18 +1,30 @@
 #define BLACK 1
 #define RED 0
+#include <climits>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
+// 结点按 value 排序，并维护两个附加信息：
+// size 为子树结点个数，用于 select / rank（顺序统计树）；
+// 每个结点同时表示区间 [value, high]，maxHigh 为子树中最大的区间右端点，用于区间重叠查询（区间树）。
+// 只插入 value 时区间为 [value, value]。
 class bst {
 private:
 
 	struct Node {
 		int value;
+		int high;
+		int size;
+		int maxHigh;
 		bool color;
 		Node *leftTree, *rightTree, *parent;
 
-		Node() : value(0), color(RED), leftTree(NULL), rightTree(NULL), parent(NULL) { }
+		Node() : value(0), high(0), size(1), maxHigh(0), color(RED), leftTree(NULL), rightTree(NULL), parent(NULL) { }
 
 		Node* grandparent() {
 			if (parent == NULL) {
@@ -39,6 +51,18 @@ private:
 		}
 	};
 
+	// 由左右孩子重新计算 p 的附加信息，NIL 的 size 为 0、maxHigh 为 INT_MIN
+	void pull(Node *p) {
+		p->size = p->leftTree->size + p->rightTree->size + 1;
+		p->maxHigh = max(p->high, max(p->leftTree->maxHigh, p->rightTree->maxHigh));
+	}
+
+	// 从 p 向上直到根，重新计算路径上每个结点的附加信息
+	void pull_up(Node *p) {
+		for (; p != NULL; p = p->parent)
+			pull(p);
+	}
+
 	void rotate_right(Node *p) {
 		Node *gp = p->grandparent();
 		Node *fa = p->parent;
@@ -62,6 +86,9 @@ private:
 				gp->rightTree = p;
 		}
 
+		// 旋转后 fa 成为 p 的孩子，先算 fa 再算 p；整棵子树的元素不变，更上层不受影响
+		pull(fa);
+		pull(p);
 	}
 
 	void rotate_left(Node *p) {
@@ -90,6 +117,9 @@ private:
 			else
 				gp->rightTree = p;
 		}
+
+		pull(fa);
+		pull(p);
 	}
 
 	void inorder(Node *p) {
@@ -135,6 +165,7 @@ private:
 			}
 			Node *smallest = getSmallestChild(p->rightTree);
 			swap(p->value, smallest->value);
+			swap(p->high, smallest->high);
 			delete_one_child(smallest);
 
 			return true;
@@ -147,8 +178,8 @@ private:
 	void delete_one_child(Node *p) {
 		Node *child = p->leftTree == NIL ? p->rightTree : p->leftTree;
 		if (p->parent == NULL && p->leftTree == NIL && p->rightTree == NIL) {
-			p = NULL;
-			root = p;
+			delete p;
+			root = NULL;
 			return;
 		}
 
@@ -167,6 +198,8 @@ private:
 			p->parent->rightTree = child;
 		}
 		child->parent = p->parent;
+		// 先修正被删结点以上的附加信息，之后 delete_case 中的旋转只需要维护旋转的两个结点
+		pull_up(p->parent);
 
 		if (p->color == BLACK) {
 			if (child->color == RED) {
@@ -230,33 +263,52 @@ private:
 		}
 	}
 
-	void insert(Node *p, int data) {
+	void insert(Node *p, int data, int high) {
 		if (p->value >= data) {
 			if (p->leftTree != NIL)
-				insert(p->leftTree, data);
+				insert(p->leftTree, data, high);
 			else {
-				Node *tmp = new Node();
-				tmp->value = data;
-				tmp->leftTree = tmp->rightTree = NIL;
+				Node *tmp = newNode(data, high);
 				tmp->parent = p;
 				p->leftTree = tmp;
+				pull_up(p);
 				insert_case(tmp);
 			}
 		}
 		else {
 			if (p->rightTree != NIL)
-				insert(p->rightTree, data);
+				insert(p->rightTree, data, high);
 			else {
-				Node *tmp = new Node();
-				tmp->value = data;
-				tmp->leftTree = tmp->rightTree = NIL;
+				Node *tmp = newNode(data, high);
 				tmp->parent = p;
 				p->rightTree = tmp;
+				pull_up(p);
 				insert_case(tmp);
 			}
 		}
 	}
 
+	Node* newNode(int data, int high) {
+		Node *tmp = new Node();
+		tmp->value = data;
+		tmp->high = tmp->maxHigh = high;
+		tmp->leftTree = tmp->rightTree = NIL;
+		return tmp;
+	}
+
+	// 中序访问与 [low, high] 重叠的区间；子树的 maxHigh 小于 low 时整棵跳过，
+	// 结点起点大于 high 时右子树的起点更大，也不用再看
+	void overlaps(Node *p, int low, int high, vector<pair<int, int> > &result) {
+		if (p == NIL || p->maxHigh < low)
+			return;
+		overlaps(p->leftTree, low, high, result);
+		if (p->value > high)
+			return;
+		if (p->high >= low)
+			result.push_back(make_pair(p->value, p->high));
+		overlaps(p->rightTree, low, high, result);
+	}
+
 	void insert_case(Node *p) {
 		if (p->parent == NULL) {
 			root = p;
@@ -309,6 +361,8 @@ public:
 	bst() {
 		NIL = new Node();
 		NIL->color = BLACK;
+		NIL->size = 0;
+		NIL->maxHigh = INT_MIN;
 		root = NULL;
 	}
 
@@ -326,24 +380,323 @@ public:
 	}
 
 	void insert(int x) {
+		insert_interval(x, x);
+	}
+
+	// 插入区间 [low, high]，按 low 排序
+	void insert_interval(int low, int high) {
 		if (root == NULL) {
-			root = new Node();
+			root = newNode(low, high);
 			root->color = BLACK;
-			root->leftTree = root->rightTree = NIL;
-			root->value = x;
 		}
 		else {
-			insert(root, x);
+			insert(root, low, high);
 		}
 	}
 
 	bool delete_value(int data) {
+		if (root == NULL)
+			return false;
 		return delete_child(root, data);
 	}
+
+	int size() {
+		return root == NULL ? 0 : root->size;
+	}
+
+	// 第 k 小的元素（k 从 1 开始），k 超出范围时返回 false
+	bool select(int k, int &result) {
+		if (root == NULL || k < 1 || k > root->size)
+			return false;
+		Node *p = root;
+		while (true) {
+			int left = p->leftTree->size;
+			if (k == left + 1) {
+				result = p->value;
+				return true;
+			}
+			if (k <= left) {
+				p = p->leftTree;
+			}
+			else {
+				k -= left + 1;
+				p = p->rightTree;
+			}
+		}
+	}
+
+	// 小于 x 的元素个数
+	int rank(int x) {
+		int r = 0;
+		Node *p = root;
+		while (p != NULL && p != NIL) {
+			if (p->value < x) {
+				r += p->leftTree->size + 1;
+				p = p->rightTree;
+			}
+			else {
+				p = p->leftTree;
+			}
+		}
+		return r;
+	}
+
+	// 所有与 [low, high] 重叠的区间，按起点排序，O(k log n)
+	vector<pair<int, int> > overlaps(int low, int high) {
+		vector<pair<int, int> > result;
+		if (root != NULL)
+			overlaps(root, low, high, result);
+		return result;
+	}
 private:
 	Node *root, *NIL;
 };
 
+// 持久化（写时复制）红黑树：每次修改只复制从根到修改位置的路径，其余子树与旧版本共享，
+// 结点由 shared_ptr 引用计数，没有版本再引用时自动释放。
+//
+// - 结点创建后不再修改，snapshot() 只是复制一次根指针，O(1)；
+//   读者拿到快照后可以任意遍历，写者之后的修改不会影响它，也不需要任何锁；
+// - 写者之间用互斥锁串行；新版本建好后用一次原子写发布，读者下次取快照时看到；
+// - 插入、删除按 Kahrs 的函数式红黑树实现（删除时先把路径上的黑结点借成红色，再用 balance 修复），
+//   与 bst 不同，相同的值只保存一份。
+//
+// 注：C++11 中 shared_ptr 的 atomic_load / atomic_store 在 libstdc++ 里不是无锁的，
+// 而是按地址从一个互斥锁池（_Sp_locker）里取一把 __gnu_cxx::__mutex 加锁，
+// 所以 snapshot() 可能短暂阻塞在写者 publish 的那次 atomic_store 上（只有复制根指针这一步）。
+// 只有取快照会碰到这把锁，遍历快照、读快照内容时完全不加锁。
+class persistent_bst {
+private:
+	struct Node;
+	typedef shared_ptr<const Node> Ptr;
+
+	struct Node {
+		int value;
+		bool color;
+		Ptr leftTree, rightTree;
+
+		Node(bool c, const Ptr &l, int v, const Ptr &r) : value(v), color(c), leftTree(l), rightTree(r) { }
+	};
+
+	// 一个版本：根和元素个数
+	struct Version {
+		Ptr root;
+		size_t size;
+	};
+
+	static Ptr make(bool color, const Ptr &l, int value, const Ptr &r) {
+		return make_shared<const Node>(color, l, value, r);
+	}
+
+	static bool isRed(const Ptr &p) {
+		return p && p->color == RED;
+	}
+
+	static bool isBlack(const Ptr &p) {
+		return p && p->color == BLACK;
+	}
+
+	// 把 l、value、r 组成一棵子树；某一侧出现红红相连时旋转成红根、两个黑孩子
+	static Ptr balance(const Ptr &l, int value, const Ptr &r) {
+		if (isRed(l) && isRed(r))
+			return make(RED, make(BLACK, l->leftTree, l->value, l->rightTree), value,
+				make(BLACK, r->leftTree, r->value, r->rightTree));
+		if (isRed(l) && isRed(l->leftTree))
+			return make(RED, make(BLACK, l->leftTree->leftTree, l->leftTree->value, l->leftTree->rightTree), l->value,
+				make(BLACK, l->rightTree, value, r));
+		if (isRed(l) && isRed(l->rightTree))
+			return make(RED, make(BLACK, l->leftTree, l->value, l->rightTree->leftTree), l->rightTree->value,
+				make(BLACK, l->rightTree->rightTree, value, r));
+		if (isRed(r) && isRed(r->rightTree))
+			return make(RED, make(BLACK, l, value, r->leftTree), r->value,
+				make(BLACK, r->rightTree->leftTree, r->rightTree->value, r->rightTree->rightTree));
+		if (isRed(r) && isRed(r->leftTree))
+			return make(RED, make(BLACK, l, value, r->leftTree->leftTree), r->leftTree->value,
+				make(BLACK, r->leftTree->rightTree, r->value, r->rightTree));
+		return make(BLACK, l, value, r);
+	}
+
+	// 调用前已确认 x 不存在
+	static Ptr ins(const Ptr &p, int x) {
+		if (!p)
+			return make(RED, Ptr(), x, Ptr());
+		if (x < p->value)
+			return p->color == BLACK ? balance(ins(p->leftTree, x), p->value, p->rightTree)
+				: make(RED, ins(p->leftTree, x), p->value, p->rightTree);
+		if (x > p->value)
+			return p->color == BLACK ? balance(p->leftTree, p->value, ins(p->rightTree, x))
+				: make(RED, p->leftTree, p->value, ins(p->rightTree, x));
+		return p;
+	}
+
+	// 黑结点改为红色，用于删除后左右黑高差一时借一个黑结点
+	static Ptr redden(const Ptr &p) {
+		return make(RED, p->leftTree, p->value, p->rightTree);
+	}
+
+	// 左子树删除后黑高少了 1
+	static Ptr balanceLeft(const Ptr &l, int value, const Ptr &r) {
+		if (isRed(l))
+			return make(RED, make(BLACK, l->leftTree, l->value, l->rightTree), value, r);
+		if (isBlack(r))
+			return balance(l, value, redden(r));
+		// r 为红色，它的左孩子必为黑色
+		return make(RED, make(BLACK, l, value, r->leftTree->leftTree), r->leftTree->value,
+			balance(r->leftTree->rightTree, r->value, redden(r->rightTree)));
+	}
+
+	// 右子树删除后黑高少了 1
+	static Ptr balanceRight(const Ptr &l, int value, const Ptr &r) {
+		if (isRed(r))
+			return make(RED, l, value, make(BLACK, r->leftTree, r->value, r->rightTree));
+		if (isBlack(l))
+			return balance(redden(l), value, r);
+		return make(RED, balance(redden(l->leftTree), l->value, l->rightTree->leftTree), l->rightTree->value,
+			make(BLACK, l->rightTree->rightTree, value, r));
+	}
+
+	// 删除结点后把它的左右子树（黑高相同）拼接起来
+	static Ptr fuse(const Ptr &l, const Ptr &r) {
+		if (!l)
+			return r;
+		if (!r)
+			return l;
+		if (isRed(l) && isRed(r)) {
+			Ptr m = fuse(l->rightTree, r->leftTree);
+			if (isRed(m))
+				return make(RED, make(RED, l->leftTree, l->value, m->leftTree), m->value,
+					make(RED, m->rightTree, r->value, r->rightTree));
+			return make(RED, l->leftTree, l->value, make(RED, m, r->value, r->rightTree));
+		}
+		if (isBlack(l) && isBlack(r)) {
+			Ptr m = fuse(l->rightTree, r->leftTree);
+			if (isRed(m))
+				return make(RED, make(BLACK, l->leftTree, l->value, m->leftTree), m->value,
+					make(BLACK, m->rightTree, r->value, r->rightTree));
+			return balanceLeft(l->leftTree, l->value, make(BLACK, m, r->value, r->rightTree));
+		}
+		if (isRed(r))
+			return make(RED, fuse(l, r->leftTree), r->value, r->rightTree);
+		return make(RED, l->leftTree, l->value, fuse(l->rightTree, r));
+	}
+
+	// 调用前已确认 x 存在
+	static Ptr del(const Ptr &p, int x) {
+		if (x < p->value) {
+			if (isBlack(p->leftTree))
+				return balanceLeft(del(p->leftTree, x), p->value, p->rightTree);
+			return make(RED, del(p->leftTree, x), p->value, p->rightTree);
+		}
+		if (x > p->value) {
+			if (isBlack(p->rightTree))
+				return balanceRight(p->leftTree, p->value, del(p->rightTree, x));
+			return make(RED, p->leftTree, p->value, del(p->rightTree, x));
+		}
+		return fuse(p->leftTree, p->rightTree);
+	}
+
+	static Ptr blacken(const Ptr &p) {
+		if (!isRed(p))
+			return p;
+		return make(BLACK, p->leftTree, p->value, p->rightTree);
+	}
+
+	shared_ptr<const Version> load() const {
+		return atomic_load(&current);
+	}
+
+	void publish(const Ptr &root, size_t size) {
+		shared_ptr<Version> v = make_shared<Version>();
+		v->root = root;
+		v->size = size;
+		atomic_store(&current, shared_ptr<const Version>(v));
+	}
+
+public:
+	// 某一时刻的只读版本，持有期间其中的结点不会被释放
+	class Snapshot {
+	public:
+		explicit Snapshot(const shared_ptr<const Version> &v) : version(v) { }
+
+		size_t size() const {
+			return version->size;
+		}
+
+		bool contains(int x) const {
+			const Node *p = version->root.get();
+			while (p) {
+				if (x < p->value)
+					p = p->leftTree.get();
+				else if (x > p->value)
+					p = p->rightTree.get();
+				else
+					return true;
+			}
+			return false;
+		}
+
+		// 按从小到大的顺序对每个元素调用 f，用显式栈代替递归
+		template <class F>
+		void for_each(F f) const {
+			vector<const Node *> stack;
+			const Node *p = version->root.get();
+			while (p || !stack.empty()) {
+				while (p) {
+					stack.push_back(p);
+					p = p->leftTree.get();
+				}
+				p = stack.back();
+				stack.pop_back();
+				f(p->value);
+				p = p->rightTree.get();
+			}
+		}
+
+		void inorder() const {
+			for_each([](int v) { cout << v << " "; });
+			cout << endl;
+		}
+
+	private:
+		shared_ptr<const Version> version;
+	};
+
+	persistent_bst() {
+		publish(Ptr(), 0);
+	}
+
+	// O(1)：复制当前版本的根
+	Snapshot snapshot() const {
+		return Snapshot(load());
+	}
+
+	bool insert(int x) {
+		lock_guard<mutex> guard(writeLock);
+		shared_ptr<const Version> v = load();
+		if (Snapshot(v).contains(x))
+			return false;
+		publish(blacken(ins(v->root, x)), v->size + 1);
+		return true;
+	}
+
+	bool delete_value(int x) {
+		lock_guard<mutex> guard(writeLock);
+		shared_ptr<const Version> v = load();
+		if (!Snapshot(v).contains(x))
+			return false;
+		publish(blacken(del(v->root, x)), v->size - 1);
+		return true;
+	}
+
+	void inorder() const {
+		snapshot().inorder();
+	}
+
+private:
+	shared_ptr<const Version> current;
+	mutex writeLock;
+};
+
 int main()
 {
 	cout << "---【红黑树】---" << endl;
@@ -369,8 +722,41 @@ int main()
 	cout << "删除元素 2 后的红黑树：" << endl;
 	tree.inorder();
 
-	// 析构
-	tree.~bst();
+	// 顺序统计
+	int kth;
+	if (tree.select(2, kth))
+		cout << "第 2 小的元素：" << kth << endl;
+	cout << "小于 9 的元素个数：" << tree.rank(9) << endl;
+
+	// 区间树
+	bst timeline;
+	timeline.insert_interval(16, 21);
+	timeline.insert_interval(8, 9);
+	timeline.insert_interval(25, 30);
+	timeline.insert_interval(5, 8);
+	timeline.insert_interval(15, 23);
+	timeline.insert_interval(17, 19);
+	timeline.insert_interval(26, 26);
+	timeline.insert_interval(0, 3);
+	timeline.insert_interval(6, 10);
+	timeline.insert_interval(19, 20);
+	vector<pair<int, int> > hits = timeline.overlaps(9, 16);
+	cout << "与 [9, 16] 重叠的区间：";
+	for (size_t i = 0; i < hits.size(); ++i)
+		cout << "[" << hits[i].first << ", " << hits[i].second << "] ";
+	cout << endl;
+
+	// 持久化红黑树：快照不受之后修改的影响
+	persistent_bst index;
+	for (int i = 1; i <= 8; ++i)
+		index.insert(i * 10);
+	persistent_bst::Snapshot before = index.snapshot();
+	index.delete_value(30);
+	index.insert(35);
+	cout << "快照中的元素：";
+	before.inorder();
+	cout << "修改后的元素：";
+	index.inorder();
 
 	getchar();
 	return 0;
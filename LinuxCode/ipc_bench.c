@@ -0,0 +1,531 @@
+// 进程间通信方式性能对比：管道、Unix 域套接字、System V 消息队列、POSIX 消息队列、
+// 共享内存 + System V 信号量、共享内存 + shm_counter 信号量、共享内存环形队列（shm_ring.h）
+//
+// - 延迟：父子进程 ping-pong，统计往返时间的分位数，-H 时输出 log2 直方图；
+// - 吞吐量：子进程连续发送，父进程接收，统计 MB/s 和每秒消息数；
+// - 每种方式按 -s 指定的各个消息大小分别测试，超出系统限制的组合输出 n/a；
+// - -c 把父子进程分别绑定到两个 CPU 上，减少调度带来的抖动，也可以比较同核 / 跨核 / 跨 NUMA 的差异。
+//
+// 编译：gcc -O2 ipc_bench.c -o ipc_bench -lrt
+// 用法：./ipc_bench [-c 父进程CPU,子进程CPU] [-s 大小1,大小2,...] [-n 往返次数]
+//                   [-t 吞吐量测试的总字节数 MB] [-m 方式1,方式2,...] [-H]
+// 方式名：pipe unix sysvmsg mqueue shmsem shmfast shmring
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm_counter.h"
+#include "shm_ring.h"
+
+enum { PIPE, UNIX_SOCKET, SYSV_MSG, POSIX_MQ, SHM_SEM, SHM_FAST, SHM_RING, MECHANISMS };
+static const char *mech_names[] = {"pipe", "unix", "sysvmsg", "mqueue", "shmsem", "shmfast", "shmring"};
+
+#define MAX_SIZES   16
+#define HIST_BUCKETS 40
+
+// 单向的一条链路，ping-pong 时每个方向一条
+struct link {
+    int type;
+    size_t max;
+    int fd[2];                    // 管道 / 套接字：fd[0] 读，fd[1] 写
+    int msqid;
+    struct sysv_msg *msg;         // msgsnd / msgrcv 使用的缓冲区
+    mqd_t mqd;
+    char name[64];
+    shm_ring_t ring;
+    char *buf;                    // 共享内存 + 信号量：共享缓冲区
+    size_t *buf_len;
+    int semid;                    // System V 信号量：0 为 empty，1 为 full
+    shm_counter_t empty, full;    // shm_counter 信号量
+};
+
+union semun {
+    int val;
+    struct semid_ds *buf;
+    unsigned short *array;
+};
+
+struct sysv_msg {
+    long mtype;
+    char mtext[1];
+};
+
+static int parent_cpu = -1, child_cpu = -1;
+static int histogram;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static long read_limit(const char *path, long fallback)
+{
+    long value = fallback;
+    FILE *fp = fopen(path, "r");
+    if (fp != NULL) {
+        if (fscanf(fp, "%ld", &value) != 1)
+            value = fallback;
+        fclose(fp);
+    }
+    return value;
+}
+
+static void die(const char *what)
+{
+    perror(what);
+    _exit(1);
+}
+
+static void pin(int cpu)
+{
+    if (cpu < 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        die("sched_setaffinity");
+}
+
+static void sem_change(int semid, int num, short op)
+{
+    struct sembuf sops = {(unsigned short)num, op, 0};
+    while (semop(semid, &sops, 1) == -1) {
+        if (errno != EINTR)
+            die("semop");
+    }
+}
+
+// 创建链路，超出系统限制时返回 -1
+static int link_create(struct link *l, int type, size_t max, int id)
+{
+    memset(l, 0, sizeof(*l));
+    l->type = type;
+    l->max = max;
+    snprintf(l->name, sizeof(l->name), "/ipc_bench_%d_%d", (int)getpid(), id);
+    switch (type) {
+    case PIPE:
+        if (pipe(l->fd) != 0)
+            die("pipe");
+        return 0;
+    case UNIX_SOCKET:
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, l->fd) != 0)
+            die("socketpair");
+        return 0;
+    case SYSV_MSG:
+        if ((long)max > read_limit("/proc/sys/kernel/msgmax", 8192))
+            return -1;
+        if ((l->msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1)
+            die("msgget");
+        l->msg = (struct sysv_msg *)malloc(sizeof(long) + max);
+        return 0;
+    case POSIX_MQ: {
+        struct mq_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.mq_maxmsg = read_limit("/proc/sys/fs/mqueue/msg_max", 10);
+        attr.mq_msgsize = max;
+        mq_unlink(l->name);
+        l->mqd = mq_open(l->name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+        if (l->mqd == (mqd_t)-1)
+            return -1;
+        mq_unlink(l->name);   // 已打开的描述符 fork 后继续有效
+        return 0;
+    }
+    case SHM_SEM: {
+        union semun arg;
+        l->buf = (char *)mmap(NULL, max + sizeof(size_t), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (l->buf == MAP_FAILED)
+            die("mmap");
+        l->buf_len = (size_t *)(l->buf + max);
+        if ((l->semid = semget(IPC_PRIVATE, 2, IPC_CREAT | 0600)) == -1)
+            die("semget");
+        arg.val = 1;
+        semctl(l->semid, 0, SETVAL, arg);
+        arg.val = 0;
+        semctl(l->semid, 1, SETVAL, arg);
+        return 0;
+    }
+    case SHM_FAST: {
+        char name[80];
+        l->buf = (char *)mmap(NULL, max + sizeof(size_t), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (l->buf == MAP_FAILED)
+            die("mmap");
+        l->buf_len = (size_t *)(l->buf + max);
+        snprintf(name, sizeof(name), "%s_empty", l->name);
+        shm_unlink(name);
+        if (shm_counter_create(&l->empty, name, 1) != 0)
+            die("shm_counter_create");
+        shm_unlink(name);
+        snprintf(name, sizeof(name), "%s_full", l->name);
+        shm_unlink(name);
+        if (shm_counter_create(&l->full, name, 0) != 0)
+            die("shm_counter_create");
+        shm_unlink(name);
+        return 0;
+    }
+    default: {
+        size_t cap = 1 << 20;
+        while (cap < 8 * (max + SHM_RING_HEADER_SIZE))
+            cap <<= 1;
+        shm_ring_unlink(l->name);
+        int ret = shm_ring_create(&l->ring, l->name, cap, 0);
+        if (ret != 0) {
+            errno = -ret;
+            die("shm_ring_create");
+        }
+        shm_ring_unlink(l->name);   // 映射 fork 后继续有效
+        return 0;
+    }
+    }
+}
+
+static void link_destroy(struct link *l)
+{
+    switch (l->type) {
+    case PIPE:
+    case UNIX_SOCKET:
+        close(l->fd[0]);
+        close(l->fd[1]);
+        break;
+    case SYSV_MSG:
+        msgctl(l->msqid, IPC_RMID, NULL);
+        free(l->msg);
+        break;
+    case POSIX_MQ:
+        mq_close(l->mqd);
+        break;
+    case SHM_SEM:
+        semctl(l->semid, 0, IPC_RMID);
+        munmap(l->buf, l->max + sizeof(size_t));
+        break;
+    case SHM_FAST:
+        semctl(l->empty.ctl->semid, 0, IPC_RMID);
+        semctl(l->full.ctl->semid, 0, IPC_RMID);
+        shm_counter_detach(&l->empty);
+        shm_counter_detach(&l->full);
+        munmap(l->buf, l->max + sizeof(size_t));
+        break;
+    default:
+        shm_ring_detach(&l->ring);
+        break;
+    }
+}
+
+// 字节流需要读满
+static void read_full(int fd, char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            die("read");
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void write_full(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            die("write");
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void link_send(struct link *l, const char *data, size_t len)
+{
+    switch (l->type) {
+    case PIPE:
+    case UNIX_SOCKET:
+        write_full(l->fd[1], data, len);
+        break;
+    case SYSV_MSG:
+        l->msg->mtype = 1;
+        memcpy(l->msg->mtext, data, len);
+        while (msgsnd(l->msqid, l->msg, len, 0) == -1) {
+            if (errno != EINTR)
+                die("msgsnd");
+        }
+        break;
+    case POSIX_MQ:
+        while (mq_send(l->mqd, data, len, 0) == -1) {
+            if (errno != EINTR)
+                die("mq_send");
+        }
+        break;
+    case SHM_SEM:
+        sem_change(l->semid, 0, -1);
+        memcpy(l->buf, data, len);
+        *l->buf_len = len;
+        sem_change(l->semid, 1, 1);
+        break;
+    case SHM_FAST:
+        if (shm_counter_wait(&l->empty) != 0)
+            die("shm_counter_wait");
+        memcpy(l->buf, data, len);
+        *l->buf_len = len;
+        if (shm_counter_post(&l->full) != 0)
+            die("shm_counter_post");
+        break;
+    default:
+        if (shm_ring_send(&l->ring, data, (uint32_t)len, 0) != 0)
+            die("shm_ring_send");
+        break;
+    }
+}
+
+static void link_recv(struct link *l, char *data, size_t len)
+{
+    ssize_t n = (ssize_t)len;
+    switch (l->type) {
+    case PIPE:
+    case UNIX_SOCKET:
+        read_full(l->fd[0], data, len);
+        break;
+    case SYSV_MSG:
+        while ((n = msgrcv(l->msqid, l->msg, l->max, 1, 0)) == -1) {
+            if (errno != EINTR)
+                die("msgrcv");
+        }
+        memcpy(data, l->msg->mtext, n);
+        break;
+    case POSIX_MQ:
+        while ((n = mq_receive(l->mqd, data, l->max, NULL)) == -1) {
+            if (errno != EINTR)
+                die("mq_receive");
+        }
+        break;
+    case SHM_SEM:
+        sem_change(l->semid, 1, -1);
+        n = (ssize_t)*l->buf_len;
+        memcpy(data, l->buf, n);
+        sem_change(l->semid, 0, 1);
+        break;
+    case SHM_FAST:
+        if (shm_counter_wait(&l->full) != 0)
+            die("shm_counter_wait");
+        n = (ssize_t)*l->buf_len;
+        memcpy(data, l->buf, n);
+        if (shm_counter_post(&l->empty) != 0)
+            die("shm_counter_post");
+        break;
+    default:
+        n = shm_ring_recv(&l->ring, data, l->max, 0);
+        break;
+    }
+    if (n != (ssize_t)len) {
+        fprintf(stderr, "%s: short message %zd of %zu\n", mech_names[l->type], n, len);
+        _exit(1);
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_histogram(const uint64_t *rtt, int rounds)
+{
+    int hist[HIST_BUCKETS] = {0}, peak = 0;
+    for (int i = 0; i < rounds; ++i) {
+        int b = 0;
+        while (b < HIST_BUCKETS - 1 && (rtt[i] >> (b + 1)) != 0)
+            ++b;
+        if (++hist[b] > peak)
+            peak = hist[b];
+    }
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        if (hist[b] == 0)
+            continue;
+        char bar[51];
+        int width = (int)((long long)hist[b] * 50 / peak);
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        printf("    [%10llu, %10llu) ns %8d %s\n", 1ull << b, 1ull << (b + 1), hist[b], bar);
+    }
+}
+
+static void bench_latency(int type, size_t size, int rounds)
+{
+    struct link ping, pong;
+    if (link_create(&ping, type, size, 0) != 0) {
+        printf("%-8s %8zu %10s\n", mech_names[type], size, "n/a");
+        return;
+    }
+    link_create(&pong, type, size, 1);
+    char *buf = (char *)calloc(1, size);
+    int warmup = rounds / 10;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        pin(child_cpu);
+        for (int i = 0; i < warmup + rounds; ++i) {
+            link_recv(&ping, buf, size);
+            link_send(&pong, buf, size);
+        }
+        _exit(0);
+    }
+
+    uint64_t *rtt = (uint64_t *)malloc(sizeof(uint64_t) * rounds);
+    for (int i = 0; i < warmup + rounds; ++i) {
+        uint64_t start = now_ns();
+        link_send(&ping, buf, size);
+        link_recv(&pong, buf, size);
+        if (i >= warmup)
+            rtt[i - warmup] = now_ns() - start;
+    }
+    waitpid(pid, NULL, 0);
+
+    qsort(rtt, rounds, sizeof(uint64_t), compare_u64);
+    printf("%-8s %8zu %10llu %10llu %10llu %10llu %10llu\n", mech_names[type], size,
+           (unsigned long long)rtt[0], (unsigned long long)rtt[rounds / 2],
+           (unsigned long long)rtt[rounds * 99 / 100], (unsigned long long)rtt[rounds * 999 / 1000],
+           (unsigned long long)rtt[rounds - 1]);
+    if (histogram)
+        print_histogram(rtt, rounds);
+    free(rtt);
+    free(buf);
+    link_destroy(&ping);
+    link_destroy(&pong);
+}
+
+static void bench_throughput(int type, size_t size, size_t total)
+{
+    struct link l;
+    if (link_create(&l, type, size, 2) != 0) {
+        printf("%-8s %8zu %12s\n", mech_names[type], size, "n/a");
+        return;
+    }
+    char *buf = (char *)calloc(1, size);
+    long count = (long)(total / size);
+    if (count < 1000)
+        count = 1000;
+
+    uint64_t start = now_ns();
+    pid_t pid = fork();
+    if (pid == 0) {
+        pin(child_cpu);
+        for (long i = 0; i < count; ++i)
+            link_send(&l, buf, size);
+        _exit(0);
+    }
+    for (long i = 0; i < count; ++i)
+        link_recv(&l, buf, size);
+    double seconds = (now_ns() - start) / 1e9;
+    waitpid(pid, NULL, 0);
+
+    printf("%-8s %8zu %12.1f %12.3f\n", mech_names[type], size, count * (double)size / seconds / 1e6,
+           count / seconds / 1e6);
+    free(buf);
+    link_destroy(&l);
+}
+
+static int parse_list(char *arg, long *out, int max)
+{
+    int n = 0;
+    for (char *tok = strtok(arg, ","); tok != NULL && n < max; tok = strtok(NULL, ","))
+        out[n++] = atol(tok);
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    long sizes[MAX_SIZES] = {64, 1024, 16384, 65536};
+    int nsizes = 4, rounds = 100000, selected[MECHANISMS];
+    size_t total = (size_t)256 << 20;
+    int opt;
+
+    for (int m = 0; m < MECHANISMS; ++m)
+        selected[m] = 1;
+    while ((opt = getopt(argc, argv, "c:s:n:t:m:H")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (sscanf(optarg, "%d,%d", &parent_cpu, &child_cpu) != 2) {
+                fprintf(stderr, "-c expects parent_cpu,child_cpu\n");
+                exit(1);
+            }
+            break;
+        case 's':
+            nsizes = parse_list(optarg, sizes, MAX_SIZES);
+            break;
+        case 'n':
+            rounds = atoi(optarg);
+            break;
+        case 't':
+            total = (size_t)atol(optarg) << 20;
+            break;
+        case 'm':
+            for (int m = 0; m < MECHANISMS; ++m)
+                selected[m] = 0;
+            for (char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+                int m;
+                for (m = 0; m < MECHANISMS && strcmp(tok, mech_names[m]) != 0; ++m)
+                    ;
+                if (m == MECHANISMS) {
+                    fprintf(stderr, "unknown mechanism %s\n", tok);
+                    exit(1);
+                }
+                selected[m] = 1;
+            }
+            break;
+        case 'H':
+            histogram = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c cpu,cpu] [-s sizes] [-n rounds] [-t MB] [-m mechs] [-H]\n",
+                    argv[0]);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < nsizes; ++i) {
+        if (sizes[i] <= 0) {
+            fprintf(stderr, "message sizes must be positive\n");
+            exit(1);
+        }
+    }
+    if (rounds <= 0 || total == 0) {
+        fprintf(stderr, "rounds and total must be positive\n");
+        exit(1);
+    }
+    pin(parent_cpu);
+
+    printf("rounds=%d throughput=%zu MB cpus=%d,%d\n", rounds, total >> 20, parent_cpu, child_cpu);
+    printf("\nround-trip latency (ns)\n%-8s %8s %10s %10s %10s %10s %10s\n", "mech", "size", "min",
+           "p50", "p99", "p999", "max");
+    for (int m = 0; m < MECHANISMS; ++m)
+        for (int i = 0; selected[m] && i < nsizes; ++i)
+            bench_latency(m, (size_t)sizes[i], rounds);
+
+    printf("\nthroughput\n%-8s %8s %12s %12s\n", "mech", "size", "MB/s", "M msgs/s");
+    for (int m = 0; m < MECHANISMS; ++m)
+        for (int i = 0; selected[m] && i < nsizes; ++i)
+            bench_throughput(m, (size_t)sizes[i], total);
+    return 0;
+}
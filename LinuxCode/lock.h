@@ -1,14 +1,16 @@
 #ifndef LOCKER_H
 #define LOCKER_H
 
+#include <errno.h>
 #include <exception>
 #include <pthread.h>
 #include <semaphore.h>
+#include <time.h>
 
 class sem{
 public:
     sem() {
-        if(sem_init(&m_sem, 0, 0) != 0);
+        if(sem_init(&m_sem, 0, 0) != 0)
             throw std::exception();
     }
     ~sem() { sem_destroy(&m_sem); }
@@ -59,4 +61,89 @@ private:
     pthread_cond_t m_cond;
 };
 
+// 以下两个类用于多进程：对象放在共享内存中，由一个进程 placement new 构造一次，
+// 其他进程通过映射直接使用（不要再构造），最后由一个进程显式调用析构函数。
+// 互斥锁是 robust 的，持锁的进程（线程）退出后，下一个加锁者会拿到锁并把它恢复为一致状态，
+// 不会像 System V 信号量那样永远卡住。
+
+// 进程间共享、持有者退出后可自动恢复的互斥锁
+class shared_locker{
+public:
+    shared_locker() : m_recovered(0) {
+        pthread_mutexattr_t attr;
+        if(pthread_mutexattr_init(&attr) != 0)
+            throw std::exception();
+        int ret = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        if(ret == 0)
+            ret = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        if(ret == 0)
+            ret = pthread_mutex_init(&m_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        if(ret != 0)
+            throw std::exception();
+    }
+    ~shared_locker() { pthread_mutex_destroy(&m_mutex); }
+    // recovered 非空时返回上一个持有者是否在持锁时退出，此时锁保护的数据可能只改了一半，由调用方修复
+    bool lock(bool* recovered = NULL) { return check(pthread_mutex_lock(&m_mutex), recovered); }
+    bool trylock(bool* recovered = NULL) { return check(pthread_mutex_trylock(&m_mutex), recovered); }
+    bool unlock(){ return pthread_mutex_unlock(&m_mutex) == 0; }
+    // 累计恢复的次数
+    unsigned recovered_count() const { return __atomic_load_n(&m_recovered, __ATOMIC_RELAXED); }
+private:
+    friend class shared_cond;
+    bool check(int ret, bool* recovered) {
+        if(recovered)
+            *recovered = ret == EOWNERDEAD;
+        if(ret == EOWNERDEAD){
+            __atomic_add_fetch(&m_recovered, 1, __ATOMIC_RELAXED);
+            return pthread_mutex_consistent(&m_mutex) == 0;
+        }
+        return ret == 0;
+    }
+    pthread_mutex_t m_mutex;
+    unsigned m_recovered;
+};
+
+// 进程间共享的条件变量，计时使用 CLOCK_MONOTONIC
+class shared_cond{
+public:
+    shared_cond() {
+        pthread_condattr_t attr;
+        if(pthread_condattr_init(&attr) != 0)
+            throw std::exception();
+        int ret = pthread_condattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        if(ret == 0)
+            ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        if(ret == 0)
+            ret = pthread_cond_init(&m_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        if(ret != 0)
+            throw std::exception();
+    }
+    ~shared_cond() { pthread_cond_destroy(&m_cond); }
+    // 与 cond::wait 相同，使用内部的锁
+    bool wait() {
+        if(!m_mutex.lock())
+            return false;
+        int ret = pthread_cond_wait(&m_cond, &m_mutex.m_mutex);
+        bool ok = m_mutex.check(ret, NULL);
+        m_mutex.unlock();
+        return ok;
+    }
+    // 调用方已持有 mutex，用于“检查条件 - 等待”的循环
+    bool wait(shared_locker& mutex, bool* recovered = NULL) {
+        return mutex.check(pthread_cond_wait(&m_cond, &mutex.m_mutex), recovered);
+    }
+    // 等到 abstime（CLOCK_MONOTONIC）为止，超时返回 false；通知方可能已经退出时用它代替 wait
+    bool timed_wait(shared_locker& mutex, const struct timespec& abstime, bool* recovered = NULL) {
+        return mutex.check(pthread_cond_timedwait(&m_cond, &mutex.m_mutex, &abstime), recovered);
+    }
+    bool signal() { return pthread_cond_signal(&m_cond) == 0; }
+    bool broadcast() { return pthread_cond_broadcast(&m_cond) == 0; }
+
+private:
+    shared_locker m_mutex;
+    pthread_cond_t m_cond;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,399 @@
+#ifndef MEMFD_CHANNEL_H
+#define MEMFD_CHANNEL_H
+
+/*
+ * 大消息零拷贝通道：小消息走 shm_ring.h 的环形队列，大消息放在 memfd 中，
+ * 通过 Unix 域套接字（SCM_RIGHTS）把文件描述符传给对方，接收方直接 mmap，不需要拷贝。
+ *
+ * - 每条消息都在环形队列中有一条记录，大消息的记录只保存缓冲区编号和长度；
+ *   发送方先发 fd 再提交记录，接收方按记录顺序取 fd，因此大小消息的先后顺序不会乱；
+ * - 发送方维护一个 memfd 缓冲池，每个缓冲区的 fd 只在第一次使用时传递，接收方保留映射，
+ *   用完后经套接字把编号还给发送方；稳定状态下不再有 memfd_create、缺页和清零页面的开销；
+ * - 缓冲区在双方之间复用，信任关系与普通共享内存相同（接收方用只读映射）；
+ * - 单生产者、单消费者，同一时刻接收方只持有一条消息（recv 之后要 done）。
+ *
+ * 使用 memfd_create，需要在所有系统头文件之前包含本文件，或自行定义 _GNU_SOURCE。
+ * 编译：gcc xxx.c -lrt
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+
+#define MEMFD_CHAN_THRESHOLD (16 * 1024)   /* 超过这个长度走 memfd */
+#define MEMFD_CHAN_POOL      8             /* 缓冲池大小，即最多同时在途的大消息数 */
+#define MEMFD_CHAN_MIN_BUF   (64 * 1024)   /* 缓冲区容量按 2 的幂取整，至少 64KB */
+
+#define MEMFD_CHAN_SMALL 1
+#define MEMFD_CHAN_LARGE 2
+#define MEMFD_CHAN_NEWFD 0x100             /* 该缓冲区换了新的 fd，接收方要重新映射 */
+
+/* 环形队列中的记录头，小消息的数据紧随其后 */
+struct memfd_chan_record {
+    uint32_t type;
+    uint32_t id;          /* 大消息：缓冲区编号 */
+    uint64_t len;
+};
+
+/* 缓冲池中的一个缓冲区，发送方和接收方各自保存自己的映射 */
+struct memfd_chan_slot {
+    int fd;               /* 仅发送方保存 */
+    int busy;             /* 发送方：已发出，等待接收方归还 */
+    void *map;
+    size_t cap;
+};
+
+typedef struct {
+    shm_ring_t ring;
+    int sock;             /* 已连接的 Unix 域套接字（SOCK_STREAM），双向使用 */
+    uint32_t threshold;
+    struct memfd_chan_slot slots[MEMFD_CHAN_POOL];
+} memfd_chan_t;
+
+/* 发送方在缓冲区中直接构造的大消息 */
+struct memfd_buf {
+    uint32_t id;
+    void *data;
+    size_t len;
+};
+
+/* 接收到的一条消息 */
+struct memfd_msg {
+    const void *data;
+    size_t len;
+    int type;
+    uint32_t id;
+};
+
+static inline void memfd_chan__init(memfd_chan_t *ch, int sock)
+{
+    ch->sock = sock;
+    ch->threshold = MEMFD_CHAN_THRESHOLD;
+    /* 小消息必须放得进环形队列 */
+    if (ch->threshold + sizeof(struct memfd_chan_record) > shm_ring_max_message(&ch->ring))
+        ch->threshold = shm_ring_max_message(&ch->ring) - sizeof(struct memfd_chan_record);
+    for (int i = 0; i < MEMFD_CHAN_POOL; ++i) {
+        ch->slots[i].fd = -1;
+        ch->slots[i].busy = 0;
+        ch->slots[i].map = NULL;
+        ch->slots[i].cap = 0;
+    }
+}
+
+/* 创建通道（通常由接收方创建环形队列），sock 的所有权交给通道 */
+static inline int memfd_chan_create(memfd_chan_t *ch, const char *ring_name, size_t ring_size, int sock)
+{
+    int ret = shm_ring_create(&ch->ring, ring_name, ring_size, 0);
+    if (ret == 0)
+        memfd_chan__init(ch, sock);
+    return ret;
+}
+
+static inline int memfd_chan_attach(memfd_chan_t *ch, const char *ring_name, int sock)
+{
+    int ret = shm_ring_attach(&ch->ring, ring_name);
+    if (ret == 0)
+        memfd_chan__init(ch, sock);
+    return ret;
+}
+
+static inline void memfd_chan_close(memfd_chan_t *ch)
+{
+    for (int i = 0; i < MEMFD_CHAN_POOL; ++i) {
+        if (ch->slots[i].map != NULL)
+            munmap(ch->slots[i].map, ch->slots[i].cap);
+        if (ch->slots[i].fd >= 0)
+            close(ch->slots[i].fd);
+    }
+    shm_ring_detach(&ch->ring);
+    close(ch->sock);
+    ch->sock = -1;
+}
+
+/* ------------------------------------------------------------------ 发送 */
+
+static inline int memfd_chan__send_fd(int sock, int fd)
+{
+    char byte = 0;
+    struct iovec iov = {&byte, 1};
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    ssize_t n;
+    while ((n = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+        ;
+    return n == 1 ? 0 : -errno;
+}
+
+static inline int memfd_chan__recv_fd(int sock)
+{
+    char byte;
+    struct iovec iov = {&byte, 1};
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    ssize_t n;
+    while ((n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    if (n <= 0)
+        return n == 0 ? -EPIPE : -errno;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        return -EPROTO;
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+/* 收回接收方归还的缓冲区编号，block 为真时至少等到一个 */
+static inline int memfd_chan__reclaim(memfd_chan_t *ch, int block)
+{
+    uint32_t ids[MEMFD_CHAN_POOL];
+    ssize_t n;
+    for (;;) {
+        n = recv(ch->sock, ids, sizeof(ids), block ? 0 : MSG_DONTWAIT);
+        if (n >= 0 || errno != EINTR)
+            break;
+    }
+    if (n <= 0) {
+        if (n == 0)
+            return -EPIPE;
+        return errno == EAGAIN ? 0 : -errno;
+    }
+    /* 编号是 4 字节，流式套接字可能只读到半个，补齐 */
+    while (n % sizeof(uint32_t) != 0) {
+        ssize_t m = recv(ch->sock, (char *)ids + n, sizeof(uint32_t) - n % sizeof(uint32_t), 0);
+        if (m <= 0) {
+            if (m < 0 && errno == EINTR)
+                continue;
+            return m == 0 ? -EPIPE : -errno;
+        }
+        n += m;
+    }
+    for (size_t i = 0; i < n / sizeof(uint32_t); ++i)
+        if (ids[i] < MEMFD_CHAN_POOL)
+            ch->slots[ids[i]].busy = 0;
+    return 0;
+}
+
+static inline size_t memfd_chan__round(size_t len)
+{
+    size_t cap = MEMFD_CHAN_MIN_BUF;
+    while (cap < len)
+        cap <<= 1;
+    return cap;
+}
+
+/* 为 slot 换一个至少 len 字节的新 memfd，并映射为可写 */
+static inline int memfd_chan__grow(struct memfd_chan_slot *s, size_t len)
+{
+    if (s->map != NULL)
+        munmap(s->map, s->cap);
+    if (s->fd >= 0)
+        close(s->fd);
+    s->map = NULL;
+    s->cap = 0;
+    s->fd = memfd_create("memfd_chan", MFD_CLOEXEC);
+    if (s->fd < 0)
+        return -errno;
+    size_t cap = memfd_chan__round(len);
+    if (ftruncate(s->fd, (off_t)cap) != 0) {
+        int err = -errno;
+        close(s->fd);
+        s->fd = -1;
+        return err;
+    }
+    void *p = mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->fd, 0);
+    if (p == MAP_FAILED) {
+        int err = -errno;
+        close(s->fd);
+        s->fd = -1;
+        return err;
+    }
+    s->map = p;
+    s->cap = cap;
+    return 0;
+}
+
+/*
+ * 从缓冲池取一个至少 len 字节的缓冲区，调用方直接在 b->data 中写入消息后调用 memfd_chan_send_buf。
+ * 缓冲区都在途时阻塞等待接收方归还。
+ */
+static inline int memfd_chan_alloc(memfd_chan_t *ch, struct memfd_buf *b, size_t len)
+{
+    int ret = memfd_chan__reclaim(ch, 0);
+    for (;;) {
+        if (ret != 0)
+            return ret;
+        /* 优先用容量够的空闲缓冲区中最小的，都不够时把容量最大的空闲缓冲区换成更大的 memfd */
+        int best = -1, largest = -1;
+        for (int i = 0; i < MEMFD_CHAN_POOL; ++i) {
+            struct memfd_chan_slot *s = &ch->slots[i];
+            if (s->busy)
+                continue;
+            if (s->cap >= len && (best < 0 || s->cap < ch->slots[best].cap))
+                best = i;
+            if (largest < 0 || s->cap > ch->slots[largest].cap)
+                largest = i;
+        }
+        if (best < 0)
+            best = largest;
+        if (best >= 0) {
+            struct memfd_chan_slot *s = &ch->slots[best];
+            if (s->cap < len && (ret = memfd_chan__grow(s, len)) != 0)
+                return ret;
+            b->id = (uint32_t)best;
+            b->data = s->map;
+            b->len = len;
+            return 0;
+        }
+        ret = memfd_chan__reclaim(ch, 1);
+    }
+}
+
+static inline int memfd_chan__publish(memfd_chan_t *ch, uint32_t type, uint32_t id, const void *data, size_t len)
+{
+    uint32_t size = sizeof(struct memfd_chan_record) + (type == MEMFD_CHAN_SMALL ? (uint32_t)len : 0);
+    struct memfd_chan_record *rec = (struct memfd_chan_record *)shm_ring_reserve(&ch->ring, size, 0);
+    if (rec == NULL)
+        return -errno;
+    rec->type = type;
+    rec->id = id;
+    rec->len = len;
+    if (type == MEMFD_CHAN_SMALL)
+        memcpy(rec + 1, data, len);
+    shm_ring_commit(&ch->ring);
+    return 0;
+}
+
+/* 发送 memfd_chan_alloc 得到的缓冲区；新建的 memfd 第一次发送时随消息传递 fd */
+static inline int memfd_chan_send_buf(memfd_chan_t *ch, struct memfd_buf *b)
+{
+    struct memfd_chan_slot *s = &ch->slots[b->id];
+    uint32_t type = MEMFD_CHAN_LARGE;
+    /* fd 传给对方后发送方就关闭它（映射仍然有效），所以 fd >= 0 表示对方还没有这个 memfd */
+    if (s->fd >= 0) {
+        int ret = memfd_chan__send_fd(ch->sock, s->fd);
+        if (ret != 0)
+            return ret;
+        close(s->fd);
+        s->fd = -1;
+        type |= MEMFD_CHAN_NEWFD;
+    }
+    s->busy = 1;
+    return memfd_chan__publish(ch, type, b->id, NULL, b->len);
+}
+
+/* 拷贝发送：小消息拷进环形队列，大消息拷进缓冲池（只有这一次拷贝） */
+static inline int memfd_chan_send(memfd_chan_t *ch, const void *data, size_t len)
+{
+    if (len <= ch->threshold)
+        return memfd_chan__publish(ch, MEMFD_CHAN_SMALL, 0, data, len);
+    struct memfd_buf b;
+    int ret = memfd_chan_alloc(ch, &b, len);
+    if (ret != 0)
+        return ret;
+    memcpy(b.data, data, len);
+    return memfd_chan_send_buf(ch, &b);
+}
+
+/* ------------------------------------------------------------------ 接收 */
+
+/* 阻塞接收一条消息；小消息指向环形队列，大消息指向缓冲区的只读映射，用完调用 memfd_chan_done */
+static inline int memfd_chan_recv(memfd_chan_t *ch, struct memfd_msg *m)
+{
+    uint32_t size;
+    const struct memfd_chan_record *rec =
+        (const struct memfd_chan_record *)shm_ring_peek(&ch->ring, &size, 0);
+    if (rec == NULL)
+        return -errno;
+    uint32_t type = rec->type;
+    m->type = (int)(type & ~MEMFD_CHAN_NEWFD);
+    m->len = rec->len;
+    m->id = rec->id;
+    if (m->type == MEMFD_CHAN_SMALL) {
+        m->data = rec + 1;
+        return 0;
+    }
+    shm_ring_release(&ch->ring);
+    if (m->id >= MEMFD_CHAN_POOL)
+        return -EPROTO;
+
+    struct memfd_chan_slot *s = &ch->slots[m->id];
+    if (type & MEMFD_CHAN_NEWFD) {
+        int fd = memfd_chan__recv_fd(ch->sock);
+        if (fd < 0)
+            return fd;
+        if (s->map != NULL)
+            munmap(s->map, s->cap);
+        s->map = NULL;
+        s->cap = 0;
+        struct stat st;
+        int ret = 0;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ret = -EPROTO;
+        } else {
+            /* MAP_POPULATE：一次建立页表，之后复用这块映射 */
+            void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ret = -errno;
+            } else {
+                s->map = p;
+                s->cap = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+        if (ret != 0)
+            return ret;
+    }
+    if (s->map == NULL || m->len > s->cap)
+        return -EPROTO;
+    m->data = s->map;
+    return 0;
+}
+
+/* 用完一条消息：小消息释放环形队列中的记录，大消息把缓冲区编号还给发送方 */
+static inline int memfd_chan_done(memfd_chan_t *ch, struct memfd_msg *m)
+{
+    if (m->type == MEMFD_CHAN_SMALL) {
+        shm_ring_release(&ch->ring);
+        return 0;
+    }
+    ssize_t n;
+    while ((n = send(ch->sock, &m->id, sizeof(m->id), MSG_NOSIGNAL)) < 0 && errno == EINTR)
+        ;
+    return n == (ssize_t)sizeof(m->id) ? 0 : -errno;
+}
+
+#endif
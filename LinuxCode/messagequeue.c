@@ -25,16 +25,16 @@ int main()
         exit(1);
     }
 
-    // 发送消息
+    // 发送消息（长度参数是 mtext 的大小，不包括 mtype）
     msg.mtype = 1;
     strncpy(msg.mtext, "Hello, message queue!", MSG_SIZE);
-    if (msgsnd(msqid, (void *)&msg, sizeof(struct message), 0) == -1) {
+    if (msgsnd(msqid, (void *)&msg, sizeof(msg.mtext), 0) == -1) {
         perror("msgsnd");
         exit(1);
     }
 
     // 接收消息
-    if (msgrcv(msqid, (void *)&msg, sizeof(struct message), 1, 0) == -1) {
+    if (msgrcv(msqid, (void *)&msg, sizeof(msg.mtext), 1, 0) == -1) {
         perror("msgrcv");
         exit(1);
     }
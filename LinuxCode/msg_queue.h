@@ -0,0 +1,274 @@
+#ifndef MSG_QUEUE_H
+#define MSG_QUEUE_H
+
+/*
+ * 进程间消息队列：变长消息 + 批量收发，两种后端
+ *
+ * - MSGQ_POSIX：POSIX 消息队列（mq_open），每条消息一次系统调用，但有内核维护的
+ *               队列深度、可以被 select/epoll 监听，适合消息不多的场合；
+ * - MSGQ_SHM：  shm_ring.h 的共享内存环形队列（单消费者，多生产者），正常流量下不进入内核，
+ *               批量收发时整批只做一次内存屏障和唤醒检查。
+ *
+ * 批量发送阻塞到整批发完（MSGQ_NONBLOCK 时发到队列满为止）；
+ * 批量接收阻塞到至少收到一条，然后取走已经到达的消息，最多 n 条。
+ *
+ * 编译：gcc xxx.c -lrt
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "shm_ring.h"
+
+#define MSGQ_POSIX    0
+#define MSGQ_SHM      1
+
+#define MSGQ_NONBLOCK SHM_RING_NONBLOCK
+
+/* 一条消息：发送时 len 为消息长度；接收时传入缓冲区大小，返回消息长度 */
+struct msgq_msg {
+    void *data;
+    uint32_t len;
+};
+
+typedef struct {
+    int backend;
+    mqd_t mqd;
+    long msgsize;     /* POSIX 队列的单条消息上限，mq_receive 要求缓冲区不小于它 */
+    char *scratch;    /* 调用方缓冲区小于 msgsize 时先收到这里再拷贝 */
+    long pending;     /* scratch 中暂存的、因缓冲区太小没能交付的消息长度，-1 表示没有 */
+    shm_ring_t ring;
+} msgq_t;
+
+static inline int msgq__open_posix(msgq_t *q, const char *name, int oflag, struct mq_attr *attr)
+{
+    struct mq_attr cur;
+    q->mqd = mq_open(name, O_RDWR | oflag, 0600, attr);
+    if (q->mqd == (mqd_t)-1)
+        return -errno;
+    mq_getattr(q->mqd, &cur);
+    q->msgsize = cur.mq_msgsize;
+    q->pending = -1;
+    q->scratch = (char *)malloc(cur.mq_msgsize);
+    if (q->scratch == NULL) {
+        mq_close(q->mqd);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+/*
+ * 创建队列：depth 为队列深度（消息条数），max_msg 为单条消息上限。
+ * 共享内存后端按 depth * max_msg 分配环形队列。成功返回 0，失败返回 -errno。
+ * POSIX 队列的深度和消息大小受 /proc/sys/fs/mqueue/msg_max、msgsize_max 限制。
+ */
+static inline int msgq_create(msgq_t *q, const char *name, int backend, uint32_t depth, uint32_t max_msg)
+{
+    memset(q, 0, sizeof(*q));
+    q->backend = backend;
+    if (backend == MSGQ_POSIX) {
+        struct mq_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.mq_maxmsg = depth;
+        attr.mq_msgsize = max_msg;
+        return msgq__open_posix(q, name, O_CREAT | O_EXCL, &attr);
+    }
+    return shm_ring_create(&q->ring, name, (size_t)depth * shm_ring__record_size(max_msg) * 2,
+                           SHM_RING_MPSC);
+}
+
+/* 打开已存在的队列 */
+static inline int msgq_open(msgq_t *q, const char *name, int backend)
+{
+    memset(q, 0, sizeof(*q));
+    q->backend = backend;
+    if (backend == MSGQ_POSIX)
+        return msgq__open_posix(q, name, 0, NULL);
+    return shm_ring_attach(&q->ring, name);
+}
+
+static inline void msgq_close(msgq_t *q)
+{
+    if (q->backend == MSGQ_POSIX) {
+        mq_close(q->mqd);
+        free(q->scratch);
+        q->scratch = NULL;
+    } else {
+        shm_ring_detach(&q->ring);
+    }
+}
+
+static inline int msgq_unlink(const char *name, int backend)
+{
+    if (backend == MSGQ_POSIX)
+        return mq_unlink(name) == 0 ? 0 : -errno;
+    return shm_ring_unlink(name);
+}
+
+/* ------------------------------------------------------------------ POSIX 后端 */
+
+/* 绝对时间 0 早已过去：队列满 / 空时 mq_timedsend / mq_timedreceive 立即返回 ETIMEDOUT */
+static const struct timespec msgq__no_wait = {0, 0};
+
+static inline int msgq__posix_send(msgq_t *q, const struct msgq_msg *msgs, int n, int flags)
+{
+    int i;
+    for (i = 0; i < n; ++i) {
+        int ret = (flags & MSGQ_NONBLOCK)
+                      ? mq_timedsend(q->mqd, (const char *)msgs[i].data, msgs[i].len, 0, &msgq__no_wait)
+                      : mq_send(q->mqd, (const char *)msgs[i].data, msgs[i].len, 0);
+        if (ret == 0)
+            continue;
+        if (errno == EINTR && !(flags & MSGQ_NONBLOCK)) {
+            --i;
+            continue;
+        }
+        if (errno == ETIMEDOUT)
+            errno = EAGAIN;
+        break;
+    }
+    return i > 0 ? i : -errno;
+}
+
+/*
+ * mq_receive 不能只看不取：缓冲区小于 msgsize 时先收到 scratch，放不下就暂存在 scratch 中，
+ * 下次接收时先交付，和共享内存后端"消息留在队列中"的行为一致。
+ * 批量中第二条起遇到小于 msgsize 的缓冲区就结束本批，不从内核取出可能放不下的消息。
+ */
+static inline int msgq__posix_recv(msgq_t *q, struct msgq_msg *msgs, int n, int flags)
+{
+    int i = 0;
+    if (q->pending >= 0) {
+        if ((uint32_t)q->pending > msgs[0].len) {
+            msgs[0].len = (uint32_t)q->pending;
+            return -EMSGSIZE;
+        }
+        memcpy(msgs[0].data, q->scratch, q->pending);
+        msgs[0].len = (uint32_t)q->pending;
+        q->pending = -1;
+        i = 1;
+    }
+    for (; i < n; ++i) {
+        int direct = msgs[i].len >= (uint32_t)q->msgsize;
+        char *buf = direct ? (char *)msgs[i].data : q->scratch;
+        ssize_t len;
+        if (!direct && i > 0)
+            break;
+        len = (i > 0 || (flags & MSGQ_NONBLOCK))
+                          ? mq_timedreceive(q->mqd, buf, q->msgsize, NULL, &msgq__no_wait)
+                          : mq_receive(q->mqd, buf, q->msgsize, NULL);
+        if (len < 0) {
+            if (errno == EINTR && i == 0 && !(flags & MSGQ_NONBLOCK)) {
+                --i;
+                continue;
+            }
+            if (errno == ETIMEDOUT)
+                errno = EAGAIN;
+            break;
+        }
+        if (!direct) {
+            /* 这里 i 一定是 0：消息已经从内核队列取出，暂存起来并告知所需长度 */
+            if ((uint32_t)len > msgs[i].len) {
+                q->pending = len;
+                msgs[i].len = (uint32_t)len;
+                errno = EMSGSIZE;
+                break;
+            }
+            memcpy(msgs[i].data, buf, len);
+        }
+        msgs[i].len = (uint32_t)len;
+    }
+    return i > 0 ? i : -errno;
+}
+
+/* ------------------------------------------------------------------ 共享内存后端 */
+
+static inline int msgq__shm_send(msgq_t *q, const struct msgq_msg *msgs, int n, int flags)
+{
+    int i;
+    for (i = 0; i < n; ++i) {
+        void *p = shm_ring_reserve(&q->ring, msgs[i].len, SHM_RING_NONBLOCK);
+        if (p == NULL && errno == EAGAIN && !(flags & MSGQ_NONBLOCK)) {
+            /* 睡眠等待空间之前先唤醒消费者，否则双方可能都在等对方 */
+            shm_ring_wake_consumer(&q->ring);
+            p = shm_ring_reserve(&q->ring, msgs[i].len, 0);
+        }
+        if (p == NULL)
+            break;
+        memcpy(p, msgs[i].data, msgs[i].len);
+        shm_ring_publish(&q->ring);
+    }
+    if (i > 0)
+        shm_ring_wake_consumer(&q->ring);
+    return i > 0 ? i : -errno;
+}
+
+static inline int msgq__shm_recv(msgq_t *q, struct msgq_msg *msgs, int n, int flags)
+{
+    int i;
+    for (i = 0; i < n; ++i) {
+        uint32_t len;
+        const void *p = shm_ring_peek(&q->ring, &len,
+                                      (i > 0 || (flags & MSGQ_NONBLOCK)) ? SHM_RING_NONBLOCK : 0);
+        if (p == NULL)
+            break;
+        if (len > msgs[i].len) {
+            /* 消息留在队列中，调用方可以换更大的缓冲区重新接收 */
+            if (i == 0)
+                msgs[i].len = len;
+            errno = EMSGSIZE;
+            break;
+        }
+        memcpy(msgs[i].data, p, len);
+        msgs[i].len = len;
+        shm_ring_consume(&q->ring);
+    }
+    if (i > 0)
+        shm_ring_wake_producers(&q->ring);
+    return i > 0 ? i : -errno;
+}
+
+/* ------------------------------------------------------------------ 接口 */
+
+/* 批量发送，返回发送的条数；一条都没发出时返回 -errno（-EAGAIN / -EMSGSIZE 等） */
+static inline int msgq_send_batch(msgq_t *q, const struct msgq_msg *msgs, int n, int flags)
+{
+    if (q->backend == MSGQ_POSIX)
+        return msgq__posix_send(q, msgs, n, flags);
+    return msgq__shm_send(q, msgs, n, flags);
+}
+
+/*
+ * 批量接收，返回收到的条数；一条都没收到时返回 -errno。
+ * 第一条消息放不下时返回 -EMSGSIZE，msgs[0].len 被改为所需长度，消息保留到下次接收；
+ * 后面的消息放不下时本批提前结束，同样不会丢消息。
+ */
+static inline int msgq_recv_batch(msgq_t *q, struct msgq_msg *msgs, int n, int flags)
+{
+    if (q->backend == MSGQ_POSIX)
+        return msgq__posix_recv(q, msgs, n, flags);
+    return msgq__shm_recv(q, msgs, n, flags);
+}
+
+static inline int msgq_send(msgq_t *q, const void *data, uint32_t len, int flags)
+{
+    struct msgq_msg msg = {(void *)data, len};
+    int ret = msgq_send_batch(q, &msg, 1, flags);
+    return ret > 0 ? 0 : ret;
+}
+
+/* 接收一条消息，返回消息长度 */
+static inline ssize_t msgq_recv(msgq_t *q, void *buf, uint32_t cap, int flags)
+{
+    struct msgq_msg msg = {buf, cap};
+    int ret = msgq_recv_batch(q, &msg, 1, flags);
+    return ret > 0 ? (ssize_t)msg.len : ret;
+}
+
+#endif
@@ -0,0 +1,278 @@
+// 消息队列性能测试：System V msgsnd/msgrcv、POSIX mqueue、共享内存环形队列
+//
+// - 吞吐量：子进程连续发送，父进程接收，按批量大小 1 和 32 分别测试，输出每秒消息数；
+// - 延迟：两个队列做 ping-pong，输出单程延迟（往返时间 / 2）的分位数。
+//
+// 编译：gcc -O2 msg_queue_bench.c -o msg_queue_bench -lrt
+// 用法：./msg_queue_bench [消息大小] [吞吐量测试消息数] [延迟测试往返次数]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msg_queue.h"
+
+#define MAX_BATCH 32
+#define MAX_SIZE  4096
+#define DEPTH     256
+
+enum { SYSV, POSIX_MQ, SHM_RING, BACKENDS };
+static const char *backend_names[] = {"sysv msgsnd", "posix mqueue", "shm ring"};
+
+// 统一三种后端的收发接口，SysV 没有批量接口，按条循环
+struct queue {
+    int backend;
+    int msqid;
+    long mtype;          // SysV：发送使用的消息类型
+    long rtype;          // SysV：接收的消息类型
+    char name[64];
+    msgq_t q;
+};
+
+struct sysv_message {
+    long mtype;
+    char mtext[MAX_SIZE];
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static long posix_depth(void)
+{
+    long depth = DEPTH;
+    FILE *fp = fopen("/proc/sys/fs/mqueue/msg_max", "r");
+    if (fp != NULL) {
+        long limit;
+        if (fscanf(fp, "%ld", &limit) == 1 && limit < depth)
+            depth = limit;
+        fclose(fp);
+    }
+    return depth;
+}
+
+static void queue_create(struct queue *q, int backend, int id, uint32_t size)
+{
+    memset(q, 0, sizeof(*q));
+    q->backend = backend;
+    snprintf(q->name, sizeof(q->name), "/msgq_bench_%d_%d", (int)getpid(), id);
+    if (backend == SYSV) {
+        if ((q->msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1) {
+            perror("msgget");
+            exit(1);
+        }
+        q->mtype = q->rtype = 1;
+        return;
+    }
+    int kind = backend == POSIX_MQ ? MSGQ_POSIX : MSGQ_SHM;
+    int ret = msgq_create(&q->q, q->name, kind, backend == POSIX_MQ ? posix_depth() : DEPTH, size);
+    if (ret != 0) {
+        fprintf(stderr, "%s: %s\n", backend_names[backend], strerror(-ret));
+        exit(1);
+    }
+}
+
+static void queue_destroy(struct queue *q)
+{
+    if (q->backend == SYSV) {
+        msgctl(q->msqid, IPC_RMID, NULL);
+        return;
+    }
+    msgq_close(&q->q);
+    msgq_unlink(q->name, q->backend == POSIX_MQ ? MSGQ_POSIX : MSGQ_SHM);
+}
+
+// fork 之后子进程重新打开（共享内存后端需要每个进程各自的句柄）
+static void queue_reopen(struct queue *q)
+{
+    if (q->backend == SYSV)
+        return;
+    msgq_close(&q->q);
+    int kind = q->backend == POSIX_MQ ? MSGQ_POSIX : MSGQ_SHM;
+    if (msgq_open(&q->q, q->name, kind) != 0) {
+        perror("msgq_open");
+        exit(1);
+    }
+}
+
+static void queue_send(struct queue *q, struct msgq_msg *msgs, int n)
+{
+    if (q->backend != SYSV) {
+        for (int sent = 0; sent < n;) {
+            int ret = msgq_send_batch(&q->q, msgs + sent, n - sent, 0);
+            if (ret < 0) {
+                fprintf(stderr, "send: %s\n", strerror(-ret));
+                exit(1);
+            }
+            sent += ret;
+        }
+        return;
+    }
+    static struct sysv_message m;
+    for (int i = 0; i < n; ++i) {
+        m.mtype = q->mtype;
+        memcpy(m.mtext, msgs[i].data, msgs[i].len);
+        // 第三个参数是 mtext 的长度，不包括 mtype
+        while (msgsnd(q->msqid, &m, msgs[i].len, 0) == -1) {
+            if (errno != EINTR) {
+                perror("msgsnd");
+                exit(1);
+            }
+        }
+    }
+}
+
+// 返回收到的条数，至少一条
+static int queue_recv(struct queue *q, struct msgq_msg *msgs, int n)
+{
+    if (q->backend != SYSV) {
+        int ret = msgq_recv_batch(&q->q, msgs, n, 0);
+        if (ret < 0) {
+            fprintf(stderr, "recv: %s\n", strerror(-ret));
+            exit(1);
+        }
+        return ret;
+    }
+    static struct sysv_message m;
+    int i;
+    for (i = 0; i < n; ++i) {
+        ssize_t len = msgrcv(q->msqid, &m, sizeof(m.mtext), q->rtype, i > 0 ? IPC_NOWAIT : 0);
+        if (len < 0) {
+            if (i > 0 && errno == ENOMSG)
+                break;
+            if (errno == EINTR) {
+                --i;
+                continue;
+            }
+            perror("msgrcv");
+            exit(1);
+        }
+        memcpy(msgs[i].data, m.mtext, len);
+        msgs[i].len = (uint32_t)len;
+    }
+    return i;
+}
+
+static char buffers[MAX_BATCH][MAX_SIZE];
+
+static void reset(struct msgq_msg *msgs, uint32_t len)
+{
+    for (int i = 0; i < MAX_BATCH; ++i) {
+        msgs[i].data = buffers[i];
+        msgs[i].len = len;
+    }
+}
+
+static void bench_throughput(int backend, int batch, uint32_t size, long count)
+{
+    struct queue q;
+    struct msgq_msg msgs[MAX_BATCH];
+    queue_create(&q, backend, 0, size);
+
+    uint64_t start = now_ns();
+    pid_t pid = fork();
+    if (pid == 0) {
+        queue_reopen(&q);
+        for (long sent = 0; sent < count; sent += batch) {
+            reset(msgs, size);
+            queue_send(&q, msgs, count - sent < batch ? (int)(count - sent) : batch);
+        }
+        _exit(0);
+    }
+    for (long received = 0; received < count;) {
+        reset(msgs, MAX_SIZE);
+        int n = queue_recv(&q, msgs, batch);
+        for (int i = 0; i < n; ++i) {
+            if (msgs[i].len != size) {
+                fprintf(stderr, "unexpected length %u\n", msgs[i].len);
+                exit(1);
+            }
+        }
+        received += n;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    waitpid(pid, NULL, 0);
+    queue_destroy(&q);
+    printf("%-14s batch=%-3d %10.3f M msgs/s %10.1f MB/s\n", backend_names[backend], batch,
+           count / seconds / 1e6, count * (double)size / seconds / 1e6);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_latency(int backend, uint32_t size, int rounds)
+{
+    struct queue ping, pong;
+    struct msgq_msg msg[MAX_BATCH];
+    queue_create(&ping, backend, 1, size);
+    queue_create(&pong, backend, 2, size);
+    if (backend == SYSV) {
+        // SysV 用一个队列、两种消息类型区分方向
+        msgctl(pong.msqid, IPC_RMID, NULL);
+        pong.msqid = ping.msqid;
+        pong.mtype = pong.rtype = 2;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        queue_reopen(&ping);
+        queue_reopen(&pong);
+        for (int i = 0; i < rounds; ++i) {
+            reset(msg, MAX_SIZE);
+            queue_recv(&ping, msg, 1);
+            queue_send(&pong, msg, 1);
+        }
+        _exit(0);
+    }
+
+    uint64_t *rtt = (uint64_t *)malloc(sizeof(uint64_t) * rounds);
+    for (int i = 0; i < rounds; ++i) {
+        uint64_t start = now_ns();
+        reset(msg, size);
+        queue_send(&ping, msg, 1);
+        reset(msg, MAX_SIZE);
+        queue_recv(&pong, msg, 1);
+        rtt[i] = now_ns() - start;
+    }
+    waitpid(pid, NULL, 0);
+    qsort(rtt, rounds, sizeof(uint64_t), compare_u64);
+    printf("%-14s one-way ns: p50 %8llu p99 %8llu p999 %8llu max %8llu\n", backend_names[backend],
+           (unsigned long long)rtt[rounds / 2] / 2, (unsigned long long)rtt[rounds * 99 / 100] / 2,
+           (unsigned long long)rtt[rounds * 999 / 1000] / 2, (unsigned long long)rtt[rounds - 1] / 2);
+    free(rtt);
+
+    if (backend != SYSV)
+        queue_destroy(&pong);
+    queue_destroy(&ping);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t size = argc > 1 ? (uint32_t)atoi(argv[1]) : 64;
+    long count = argc > 2 ? atol(argv[2]) : 1000000;
+    int rounds = argc > 3 ? atoi(argv[3]) : 100000;
+    if (size == 0 || size > MAX_SIZE || count <= 0 || rounds <= 0) {
+        fprintf(stderr, "message size must be in [1, %d]\n", MAX_SIZE);
+        exit(1);
+    }
+
+    printf("message size=%u throughput messages=%ld latency rounds=%d\n", size, count, rounds);
+    for (int b = 0; b < BACKENDS; ++b) {
+        bench_throughput(b, 1, size, count);
+        bench_throughput(b, MAX_BATCH, size, count);
+    }
+    for (int b = 0; b < BACKENDS; ++b)
+        bench_latency(b, size, rounds);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// lock.h 中 shared_locker / shared_cond 的示例：多个进程在共享内存中累加计数器，
+// 其中一个进程在持锁、数据只改了一半时被 SIGKILL 杀死，其余进程拿到锁后修复数据并继续，
+// 父进程用 shared_cond 等待所有工作进程完成。
+//
+// 编译：g++ robust_lock_demo.cpp -o robust_lock_demo -pthread
+// 用法：./robust_lock_demo [工作进程数] [每个进程累加次数]
+
+#include <new>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lock.h"
+
+// 放在共享内存中的数据：a 和 b 在锁外总是相等
+struct shared_state {
+    shared_locker mutex;
+    shared_cond done;
+    long a;
+    long b;
+    int running;
+};
+
+// 所有加锁的地方都要处理恢复：谁先拿到锁谁修复
+static void repair(shared_state* s, bool recovered) {
+    if (recovered) {
+        // 上一个持有者死在了 a、b 之间，按 a 修复
+        printf("[%d] recovered lock, repairing b %ld -> %ld\n", (int)getpid(), s->b, s->a);
+        fflush(stdout);
+        s->b = s->a;
+    }
+}
+
+static void lock_state(shared_state* s) {
+    bool recovered;
+    if (!s->mutex.lock(&recovered)) {
+        fprintf(stderr, "lock failed\n");
+        _exit(1);
+    }
+    repair(s, recovered);
+}
+
+static void worker(shared_state* s, long count) {
+    for (long i = 0; i < count; ++i) {
+        lock_state(s);
+        ++s->a;
+        ++s->b;
+        s->mutex.unlock();
+    }
+    lock_state(s);
+    --s->running;
+    s->done.signal();
+    s->mutex.unlock();
+    _exit(0);
+}
+
+// 持锁后只改了 a 就被杀死
+static void victim(shared_state* s) {
+    s->mutex.lock();
+    ++s->a;
+    kill(getpid(), SIGKILL);
+}
+
+int main(int argc, char* argv[]) {
+    int workers = argc > 1 ? atoi(argv[1]) : 4;
+    long count = argc > 2 ? atol(argv[2]) : 100000;
+
+    void* mem = mmap(NULL, sizeof(shared_state), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    shared_state* s = new (mem) shared_state();
+    s->a = s->b = 0;
+    s->running = workers;
+
+    // 先让 victim 死在锁里，再启动工作进程
+    pid_t pid = fork();
+    if (pid == 0)
+        victim(s);
+    waitpid(pid, NULL, 0);
+
+    for (int i = 0; i < workers; ++i) {
+        if (fork() == 0)
+            worker(s, count);
+    }
+
+    // 等所有工作进程完成；每秒醒来一次，通知方意外退出时不会一直等下去
+    lock_state(s);
+    while (s->running > 0) {
+        struct timespec abstime;
+        bool recovered;
+        clock_gettime(CLOCK_MONOTONIC, &abstime);
+        abstime.tv_sec += 1;
+        s->done.timed_wait(s->mutex, abstime, &recovered);
+        repair(s, recovered);
+    }
+    long a = s->a, b = s->b;
+    s->mutex.unlock();
+    while (wait(NULL) > 0)
+        ;
+
+    long expect = 1 + static_cast<long>(workers) * count;
+    printf("a=%ld b=%ld expect=%ld recovered=%u %s\n", a, b, expect, s->mutex.recovered_count(),
+           a == expect && b == expect ? "ok" : "WRONG");
+    s->~shared_state();
+    munmap(mem, sizeof(shared_state));
+    return a == expect && b == expect ? 0 : 1;
+}
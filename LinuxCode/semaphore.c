@@ -1,134 +1,60 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <sys/sem.h>
+#include <sys/wait.h>
 
-#define SEM_NAME "/test_sem"
-#define COUNTER_FILE "counter.txt"
+#include "shm_counter.h"
 
-union semun {
-    int val;
-    struct semid_ds *buf;
-    unsigned short *array;
-};
+// 计数器放在共享内存中，每次加减只是一次原子操作，不再读写 counter.txt
+// 信号量同样放在共享内存中，只有需要睡眠 / 唤醒时才调用 semop
+#define SHM_NAME "/test_sem"
+#define COUNTER 0
 
-void run_child(int semid) {
-    struct sembuf sops;
-
-    sops.sem_num = 0;
-    sops.sem_op = -1;
-    sops.sem_flg = 0;
+void run_child(shm_counter_t *c) {
+    if (shm_counter_register(c) != 0) {
+        fprintf(stderr, "shm_counter_register failed\n");
+        exit(EXIT_FAILURE);
+    }
 
     for (int i = 0; i < 10; i++) {
-        if (semop(semid, &sops, 1) == -1) {
-            perror("semop");
-            exit(EXIT_FAILURE);
-        }
+        shm_counter_add(c, COUNTER, 1);
+        printf("[Child] Incremented counter: %lld\n", (long long)shm_counter_read(c, COUNTER));
 
-        FILE *fp = fopen(COUNTER_FILE, "r+");
-        if (fp == NULL) {
-            perror("fopen");
+        // 通知父进程可以减一次
+        if (shm_counter_post(c) != 0) {
+            perror("shm_counter_post");
             exit(EXIT_FAILURE);
         }
-
-        int counter;
-        if (fscanf(fp, "%d", &counter) != 1) {
-            perror("fscanf");
-            exit(EXIT_FAILURE);
-        }
-
-        printf("[Child] Read counter: %d\n", counter);
-
-        counter++;
-
-        fseek(fp, 0, SEEK_SET);
-        fprintf(fp, "%d", counter);
-
-        fclose(fp);
-
-        sops.sem_op = 1;
-        if (semop(semid, &sops, 1) == -1) {
-            perror("semop");
-            exit(EXIT_FAILURE);
-        }
-
-        printf("[Child] Incremented counter: %d\n", counter);
     }
 }
 
-void run_parent(int semid) {
-    struct sembuf sops;
-
-    sops.sem_num = 0;
-    sops.sem_op = -1;
-    sops.sem_flg = 0;
+void run_parent(shm_counter_t *c) {
+    if (shm_counter_register(c) != 0) {
+        fprintf(stderr, "shm_counter_register failed\n");
+        exit(EXIT_FAILURE);
+    }
 
     for (int i = 0; i < 10; i++) {
-        if (semop(semid, &sops, 1) == -1) {
-            perror("semop");
-            exit(EXIT_FAILURE);
-        }
-
-        FILE *fp = fopen(COUNTER_FILE, "r+");
-        if (fp == NULL) {
-            perror("fopen");
-            exit(EXIT_FAILURE);
-        }
-
-        int counter;
-        if (fscanf(fp, "%d", &counter) != 1) {
-            perror("fscanf");
+        // 等子进程先加，计数器不会小于 0
+        if (shm_counter_wait(c) != 0) {
+            perror("shm_counter_wait");
             exit(EXIT_FAILURE);
         }
 
-        printf("[Parent] Read counter: %d\n", counter);
-
-        counter--;
-
-        fseek(fp, 0, SEEK_SET);
-        fprintf(fp, "%d", counter);
-
-        fclose(fp);
-
-        sops.sem_op = 1;
-        if (semop(semid, &sops, 1) == -1) {
-            perror("semop");
-            exit(EXIT_FAILURE);
-        }
-
-        printf("[Parent] Decremented counter: %d\n", counter);
+        shm_counter_add(c, COUNTER, -1);
+        printf("[Parent] Decremented counter: %lld\n", (long long)shm_counter_read(c, COUNTER));
     }
 }
 
 int main() {
-    key_t key;
-    int semid, counter_fd;
+    shm_counter_t counter;
+    int ret;
 
-    if ((key = ftok(SEM_NAME, 1)) == -1) {
-        perror("ftok");
-        exit(EXIT_FAILURE);
-    }
-
-    if ((semid = semget(key, 1, 0666 | IPC_CREAT)) == -1) {
-        perror("semget");
-        exit(EXIT_FAILURE);
-    }
-
-    union semun init_value;
-    init_value.val = 1;
-
-    if (semctl(semid, 0, SETVAL, init_value) == -1) {
-        perror("semctl");
-        exit(EXIT_FAILURE);
-    }
-
-    if ((counter_fd = creat(COUNTER_FILE, 0666)) == -1) {
-        perror("creat");
-        exit(EXIT_FAILURE);
-    }
-
-    if (close(counter_fd) == -1) {
-        perror("close");
+    // 上次异常退出可能留下同名对象
+    shm_unlink(SHM_NAME);
+    if ((ret = shm_counter_create(&counter, SHM_NAME, 0)) != 0) {
+        fprintf(stderr, "shm_counter_create: %s\n", strerror(-ret));
         exit(EXIT_FAILURE);
     }
 
@@ -139,20 +65,16 @@ int main() {
     }
 
     if (pid == 0) {
-        run_child(semid);
-    } else {
-        run_parent(semid);
-    }
-
-    if (semctl(semid, 0, IPC_RMID, 0) == -1) {
-        perror("semctl");
-        exit(EXIT_FAILURE);
+        run_child(&counter);
+        shm_counter_detach(&counter);
+        return 0;
     }
 
-    if (remove(COUNTER_FILE) == -1) {
-        perror("remove");
-        exit(EXIT_FAILURE);
-    }
+    run_parent(&counter);
+    waitpid(pid, NULL, 0);
+    printf("[Parent] Final counter: %lld\n", (long long)shm_counter_read(&counter, COUNTER));
 
+    shm_counter_destroy(&counter, SHM_NAME);
+    shm_counter_detach(&counter);
     return 0;
 }
@@ -0,0 +1,207 @@
+#ifndef SHM_COUNTER_H
+#define SHM_COUNTER_H
+
+/*
+ * 进程间计数器 / 统计量：放在 POSIX 共享内存中
+ *
+ * - 每个进程占一行（128 字节，两个 cache line，避免相邻行预取造成的伪共享），
+ *   累加只对本进程那一行做原子 fetch-add，不同进程之间没有 cache line 争用；
+ *   读取时把所有行相加，适合“写多读少”的统计量；
+ * - 进程退出后它那一行的数值仍然计入总和，新进程可以接管已退出进程的行；
+ * - 另带一个信号量：计数放在共享内存中，用原子操作完成 P/V，只有需要睡眠或唤醒时
+ *   才调用 System V 信号量的 semop（即 benaphore），无竞争时不进入内核。
+ *
+ * 编译：gcc xxx.c -lrt
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define SHM_COUNTER_MAGIC     0x53434e54u   /* "SCNT" */
+#define SHM_COUNTER_MAX_PROCS 64            /* 最多同时注册的进程数 */
+#define SHM_COUNTER_MAX       15            /* 每个进程一行中的计数器个数 */
+
+/* 一个进程的一行：owner + 15 个计数器 = 128 字节 */
+struct shm_counter_row {
+    int32_t owner;                          /* 0 表示空闲，否则为 pid */
+    uint32_t reserved;
+    int64_t value[SHM_COUNTER_MAX];
+} __attribute__((aligned(128)));
+
+struct shm_counter_ctl {
+    uint32_t magic;
+    int semid;                              /* 信号量慢路径使用的 System V 信号量 */
+    /* 信号量计数：大于 0 为可用资源数，小于 0 为睡眠（或即将睡眠）的进程数 */
+    int64_t sem_count __attribute__((aligned(128)));
+    struct shm_counter_row rows[SHM_COUNTER_MAX_PROCS];
+};
+
+typedef struct {
+    struct shm_counter_ctl *ctl;
+    struct shm_counter_row *row;            /* 本进程的行，shm_counter_register 之后有效 */
+} shm_counter_t;
+
+/* 创建计数器段，信号量初值为 sem_init；成功返回 0，失败返回 -errno */
+static inline int shm_counter_create(shm_counter_t *c, const char *name, int sem_init)
+{
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+        return -errno;
+    if (ftruncate(fd, sizeof(struct shm_counter_ctl)) != 0) {
+        int err = -errno;
+        close(fd);
+        shm_unlink(name);
+        return err;
+    }
+    void *p = mmap(NULL, sizeof(struct shm_counter_ctl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        int err = -errno;
+        shm_unlink(name);
+        return err;
+    }
+    c->ctl = (struct shm_counter_ctl *)p;
+    c->row = NULL;
+    /* System V 信号量只用来睡眠和唤醒，初值为 0 */
+    c->ctl->semid = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600);
+    if (c->ctl->semid == -1) {
+        int err = -errno;
+        munmap(p, sizeof(struct shm_counter_ctl));
+        shm_unlink(name);
+        return err;
+    }
+    c->ctl->sem_count = sem_init;
+    __atomic_store_n(&c->ctl->magic, SHM_COUNTER_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline int shm_counter_attach(shm_counter_t *c, const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return -errno;
+    void *p = mmap(NULL, sizeof(struct shm_counter_ctl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -errno;
+    c->ctl = (struct shm_counter_ctl *)p;
+    c->row = NULL;
+    if (__atomic_load_n(&c->ctl->magic, __ATOMIC_ACQUIRE) != SHM_COUNTER_MAGIC) {
+        munmap(p, sizeof(struct shm_counter_ctl));
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* 释放本进程的行（数值保留，继续计入总和）并解除映射 */
+static inline void shm_counter_detach(shm_counter_t *c)
+{
+    if (c->row != NULL)
+        __atomic_store_n(&c->row->owner, 0, __ATOMIC_RELEASE);
+    munmap(c->ctl, sizeof(struct shm_counter_ctl));
+    c->ctl = NULL;
+    c->row = NULL;
+}
+
+/* 删除计数器段和信号量，在最后一个使用者 detach 之前调用 */
+static inline int shm_counter_destroy(shm_counter_t *c, const char *name)
+{
+    semctl(c->ctl->semid, 0, IPC_RMID);
+    return shm_unlink(name) == 0 ? 0 : -errno;
+}
+
+/*
+ * 为本进程分配一行，累加之前必须调用（fork 出的子进程要重新调用）。
+ * 优先使用空闲行，其次接管 owner 已经退出的行。成功返回 0，行用完返回 -ENOSPC。
+ */
+static inline int shm_counter_register(shm_counter_t *c)
+{
+    int32_t self = (int32_t)getpid();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < SHM_COUNTER_MAX_PROCS; ++i) {
+            struct shm_counter_row *row = &c->ctl->rows[i];
+            int32_t owner = __atomic_load_n(&row->owner, __ATOMIC_RELAXED);
+            if (owner == self) {
+                c->row = row;
+                return 0;
+            }
+            if (pass == 0 ? owner != 0 : (owner == 0 || kill(owner, 0) == 0 || errno != ESRCH))
+                continue;
+            if (__atomic_compare_exchange_n(&row->owner, &owner, self, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                c->row = row;
+                return 0;
+            }
+        }
+    }
+    return -ENOSPC;
+}
+
+/* 累加到本进程的行，同一进程的多个线程也可以并发调用 */
+static inline void shm_counter_add(shm_counter_t *c, int id, int64_t n)
+{
+    __atomic_fetch_add(&c->row->value[id], n, __ATOMIC_RELAXED);
+}
+
+/* 所有进程之和；与并发的累加之间没有快照语义 */
+static inline int64_t shm_counter_read(const shm_counter_t *c, int id)
+{
+    int64_t sum = 0;
+    for (int i = 0; i < SHM_COUNTER_MAX_PROCS; ++i)
+        sum += __atomic_load_n(&c->ctl->rows[i].value[id], __ATOMIC_RELAXED);
+    return sum;
+}
+
+/* ------------------------------------------------------------------ 信号量 */
+
+static inline int shm_counter__semop(int semid, short op)
+{
+    struct sembuf sops;
+    sops.sem_num = 0;
+    sops.sem_op = op;
+    sops.sem_flg = 0;
+    while (semop(semid, &sops, 1) == -1) {
+        if (errno != EINTR)
+            return -errno;
+    }
+    return 0;
+}
+
+/* P 操作：有资源时只做一次原子减，否则在 System V 信号量上睡眠 */
+static inline int shm_counter_wait(shm_counter_t *c)
+{
+    if (__atomic_fetch_sub(&c->ctl->sem_count, 1, __ATOMIC_ACQUIRE) > 0)
+        return 0;
+    return shm_counter__semop(c->ctl->semid, -1);
+}
+
+/* 非阻塞 P 操作，成功返回 0，没有资源返回 -EAGAIN */
+static inline int shm_counter_trywait(shm_counter_t *c)
+{
+    int64_t count = __atomic_load_n(&c->ctl->sem_count, __ATOMIC_RELAXED);
+    while (count > 0) {
+        if (__atomic_compare_exchange_n(&c->ctl->sem_count, &count, count - 1, 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return 0;
+    }
+    return -EAGAIN;
+}
+
+/* V 操作：没有进程在等时只做一次原子加，否则用 semop 唤醒一个 */
+static inline int shm_counter_post(shm_counter_t *c)
+{
+    if (__atomic_fetch_add(&c->ctl->sem_count, 1, __ATOMIC_RELEASE) >= 0)
+        return 0;
+    return shm_counter__semop(c->ctl->semid, 1);
+}
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+/*
+ * 基于 POSIX 共享内存的进程间环形队列（单消费者，单生产者或多生产者）
+ *
+ * - shm_open + mmap 建立共享内存，控制块中 head / tail 各占一个 cache line，避免伪共享；
+ * - 消息长度可变，记录格式为 [uint32 size][uint32 len][数据]，按 8 字节对齐，
+ *   size 最后写入（release），非 0 即表示已提交；尾部放不下时写一条填充记录后回绕；
+ * - 消费者读完一条记录后把它占用的内存清零，因此未提交的位置总是 0，
+ *   多个生产者可以乱序提交而消费者按顺序读取；
+ * - 双方在队列空 / 满时先自旋，仍不满足才用 futex 睡眠，对方看到等待标志才调用 futex_wake，
+ *   收发两端在正常流量下都不进入内核。
+ *
+ * C 和 C++ 都可以直接包含，只依赖 GCC 的 __atomic 内建函数。
+ * 编译：gcc xxx.c -lrt（glibc 2.34 之前 shm_open 在 librt 中）
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_RING_MAGIC       0x53524e47u   /* "SRNG" */
+#define SHM_RING_CACHE_LINE  64
+#define SHM_RING_HEADER_SIZE 8
+#define SHM_RING_PAD_FLAG    0x80000000u   /* size 的最高位：填充记录 */
+#define SHM_RING_SPIN        2000          /* 多核时睡眠前的自旋次数 */
+
+/* 创建标志 */
+#define SHM_RING_MPSC        1             /* 允许多个生产者（CAS 预留空间） */
+
+/* 收发标志 */
+#define SHM_RING_NONBLOCK    1
+
+/* 共享内存中的控制块，数据区紧随其后（偏移 4096） */
+struct shm_ring_ctl {
+    /* 只读信息 */
+    uint32_t magic;
+    uint32_t flags;
+    uint64_t capacity;
+    uint64_t mask;
+    /* 生产者写 */
+    uint64_t tail __attribute__((aligned(SHM_RING_CACHE_LINE)));
+    /* 消费者写 */
+    uint64_t head __attribute__((aligned(SHM_RING_CACHE_LINE)));
+    /* 消费者睡眠：生产者提交后若看到 consumer_waiting，递增 data_seq 并唤醒 */
+    uint32_t data_seq __attribute__((aligned(SHM_RING_CACHE_LINE)));
+    uint32_t consumer_waiting;
+    /* 生产者睡眠：消费者释放空间后若看到 producer_waiting，递增 space_seq 并唤醒 */
+    uint32_t space_seq __attribute__((aligned(SHM_RING_CACHE_LINE)));
+    uint32_t producer_waiting;
+};
+
+#define SHM_RING_DATA_OFFSET 4096
+
+/* 每个进程（线程）各自持有的句柄 */
+typedef struct {
+    struct shm_ring_ctl *ctl;
+    char *data;
+    size_t map_size;
+    uint64_t head_cache;    /* 生产者缓存的 head，减少对消费者 cache line 的读取 */
+    uint64_t reserved;      /* 最近一次 reserve 的位置，commit 时使用 */
+    int spin;               /* 睡眠前的自旋次数，单核时自旋只会占用对方的时间片，取 0 */
+} shm_ring_t;
+
+static inline long shm_ring__futex(uint32_t *addr, int op, uint32_t val)
+{
+    return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+static inline void shm_ring__pause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint32_t shm_ring__record_size(uint32_t len)
+{
+    return (SHM_RING_HEADER_SIZE + len + 7) & ~7u;
+}
+
+/* 单条消息的最大长度：保证任何时候都能放进一个空队列 */
+static inline uint32_t shm_ring_max_message(const shm_ring_t *r)
+{
+    return (uint32_t)(r->ctl->capacity / 2) - SHM_RING_HEADER_SIZE;
+}
+
+static inline int shm_ring__map(shm_ring_t *r, int fd, size_t map_size)
+{
+    void *p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return -errno;
+    r->ctl = (struct shm_ring_ctl *)p;
+    r->data = (char *)p + SHM_RING_DATA_OFFSET;
+    r->map_size = map_size;
+    r->head_cache = 0;
+    r->reserved = 0;
+    r->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_RING_SPIN : 0;
+    return 0;
+}
+
+/* 创建队列，capacity 向上取整为 2 的幂；成功返回 0，失败返回 -errno */
+static inline int shm_ring_create(shm_ring_t *r, const char *name, size_t capacity, int flags)
+{
+    size_t cap = 4096;
+    while (cap < capacity)
+        cap <<= 1;
+    if (cap > (size_t)1 << 31)
+        return -EINVAL;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+        return -errno;
+    size_t map_size = SHM_RING_DATA_OFFSET + cap;
+    if (ftruncate(fd, (off_t)map_size) != 0) {
+        int err = -errno;
+        close(fd);
+        shm_unlink(name);
+        return err;
+    }
+    int ret = shm_ring__map(r, fd, map_size);
+    close(fd);
+    if (ret != 0) {
+        shm_unlink(name);
+        return ret;
+    }
+    /* ftruncate 得到的内存全为 0，只需填写只读信息，magic 最后写入表示初始化完成 */
+    r->ctl->flags = (uint32_t)flags;
+    r->ctl->capacity = cap;
+    r->ctl->mask = cap - 1;
+    __atomic_store_n(&r->ctl->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* 连接已存在的队列 */
+static inline int shm_ring_attach(shm_ring_t *r, const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return -errno;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= SHM_RING_DATA_OFFSET) {
+        close(fd);
+        return -EINVAL;
+    }
+    int ret = shm_ring__map(r, fd, (size_t)st.st_size);
+    close(fd);
+    if (ret != 0)
+        return ret;
+    if (__atomic_load_n(&r->ctl->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ||
+        SHM_RING_DATA_OFFSET + r->ctl->capacity != r->map_size) {
+        munmap(r->ctl, r->map_size);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static inline void shm_ring_detach(shm_ring_t *r)
+{
+    if (r->ctl != NULL)
+        munmap(r->ctl, r->map_size);
+    r->ctl = NULL;
+}
+
+static inline int shm_ring_unlink(const char *name)
+{
+    return shm_unlink(name) == 0 ? 0 : -errno;
+}
+
+/* ------------------------------------------------------------------ 生产者 */
+
+/* 尝试预留一条 len 字节的记录，成功返回数据区指针，队列满返回 NULL */
+static inline void *shm_ring__try_reserve(shm_ring_t *r, uint32_t len)
+{
+    struct shm_ring_ctl *ctl = r->ctl;
+    uint64_t cap = ctl->capacity;
+    uint64_t need = shm_ring__record_size(len);
+    uint64_t tail, pos, total;
+
+    tail = __atomic_load_n(&ctl->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        pos = tail & ctl->mask;
+        total = need <= cap - pos ? need : (cap - pos) + need;
+        if (tail + total - r->head_cache > cap) {
+            r->head_cache = __atomic_load_n(&ctl->head, __ATOMIC_ACQUIRE);
+            if (tail + total - r->head_cache > cap)
+                return NULL;
+        }
+        if (!(ctl->flags & SHM_RING_MPSC)) {
+            __atomic_store_n(&ctl->tail, tail + total, __ATOMIC_RELAXED);
+            break;
+        }
+        if (__atomic_compare_exchange_n(&ctl->tail, &tail, tail + total, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+    if (total != need) {
+        /* 尾部放不下：填充记录立即提交，真正的记录从 0 开始 */
+        __atomic_store_n((uint32_t *)(r->data + pos), (uint32_t)(cap - pos) | SHM_RING_PAD_FLAG,
+                         __ATOMIC_RELEASE);
+        pos = 0;
+    }
+    ((uint32_t *)(r->data + pos))[1] = len;
+    r->reserved = pos;
+    return r->data + pos + SHM_RING_HEADER_SIZE;
+}
+
+static inline void shm_ring__notify(uint32_t *waiting, uint32_t *seq, int count)
+{
+    /* 与对方“设置等待标志后再检查一次”配对的全屏障，保证不会丢失唤醒 */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(seq, 1, __ATOMIC_RELEASE);
+        shm_ring__futex(seq, FUTEX_WAKE, (uint32_t)count);
+    }
+}
+
+/*
+ * 零拷贝发送：预留 len 字节并返回指针，填好数据后调用 shm_ring_commit。
+ * 队列满时阻塞（flags 含 SHM_RING_NONBLOCK 时返回 NULL 且 errno = EAGAIN）。
+ * 同一句柄在 commit 之前不能再次 reserve；多线程发送时每个线程各自 attach 一个句柄。
+ */
+static inline void *shm_ring_reserve(shm_ring_t *r, uint32_t len, int flags)
+{
+    struct shm_ring_ctl *ctl = r->ctl;
+    if (len > shm_ring_max_message(r)) {
+        errno = EMSGSIZE;
+        return NULL;
+    }
+    for (;;) {
+        for (int i = 0;; ++i) {
+            void *p = shm_ring__try_reserve(r, len);
+            if (p != NULL)
+                return p;
+            if (flags & SHM_RING_NONBLOCK) {
+                errno = EAGAIN;
+                return NULL;
+            }
+            if (i >= r->spin)
+                break;
+            shm_ring__pause();
+        }
+        uint32_t seq = __atomic_load_n(&ctl->space_seq, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&ctl->producer_waiting, 1, __ATOMIC_SEQ_CST);
+        void *p = shm_ring__try_reserve(r, len);
+        if (p == NULL)
+            shm_ring__futex(&ctl->space_seq, FUTEX_WAIT, seq);
+        __atomic_sub_fetch(&ctl->producer_waiting, 1, __ATOMIC_RELAXED);
+        if (p != NULL)
+            return p;
+    }
+}
+
+/* 只提交不唤醒，批量发送时最后调用一次 shm_ring_wake_consumer */
+static inline void shm_ring_publish(shm_ring_t *r)
+{
+    uint32_t *hdr = (uint32_t *)(r->data + r->reserved);
+    __atomic_store_n(&hdr[0], shm_ring__record_size(hdr[1]), __ATOMIC_RELEASE);
+}
+
+static inline void shm_ring_wake_consumer(shm_ring_t *r)
+{
+    shm_ring__notify(&r->ctl->consumer_waiting, &r->ctl->data_seq, 1);
+}
+
+static inline void shm_ring_commit(shm_ring_t *r)
+{
+    shm_ring_publish(r);
+    shm_ring_wake_consumer(r);
+}
+
+/* 拷贝发送，成功返回 0，失败返回 -EAGAIN / -EMSGSIZE */
+static inline int shm_ring_send(shm_ring_t *r, const void *msg, uint32_t len, int flags)
+{
+    void *p = shm_ring_reserve(r, len, flags);
+    if (p == NULL)
+        return -errno;
+    memcpy(p, msg, len);
+    shm_ring_commit(r);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ 消费者 */
+
+/* 返回 head 处已提交记录的 size（跳过填充记录），没有则返回 0 */
+static inline uint32_t shm_ring__ready(shm_ring_t *r)
+{
+    struct shm_ring_ctl *ctl = r->ctl;
+    for (;;) {
+        uint64_t head = ctl->head;
+        uint64_t pos = head & ctl->mask;
+        uint32_t size = __atomic_load_n((uint32_t *)(r->data + pos), __ATOMIC_ACQUIRE);
+        if (!(size & SHM_RING_PAD_FLAG))
+            return size;
+        size &= ~SHM_RING_PAD_FLAG;
+        *(uint32_t *)(r->data + pos) = 0;  /* 填充区除记录头外本来就是 0 */
+        __atomic_store_n(&ctl->head, head + size, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * 零拷贝接收：返回下一条消息的指针并通过 len 返回长度，用完后调用 shm_ring_release。
+ * 队列空时阻塞（flags 含 SHM_RING_NONBLOCK 时返回 NULL 且 errno = EAGAIN）。
+ */
+static inline const void *shm_ring_peek(shm_ring_t *r, uint32_t *len, int flags)
+{
+    struct shm_ring_ctl *ctl = r->ctl;
+    for (;;) {
+        for (int i = 0;; ++i) {
+            if (shm_ring__ready(r) != 0) {
+                char *rec = r->data + (ctl->head & ctl->mask);
+                *len = ((uint32_t *)rec)[1];
+                return rec + SHM_RING_HEADER_SIZE;
+            }
+            if (flags & SHM_RING_NONBLOCK) {
+                errno = EAGAIN;
+                return NULL;
+            }
+            if (i >= r->spin)
+                break;
+            shm_ring__pause();
+        }
+        uint32_t seq = __atomic_load_n(&ctl->data_seq, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&ctl->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+        if (shm_ring__ready(r) == 0)
+            shm_ring__futex(&ctl->data_seq, FUTEX_WAIT, seq);
+        __atomic_store_n(&ctl->consumer_waiting, 0, __ATOMIC_RELAXED);
+    }
+}
+
+/* 只释放不唤醒，批量接收时最后调用一次 shm_ring_wake_producers */
+static inline void shm_ring_consume(shm_ring_t *r)
+{
+    struct shm_ring_ctl *ctl = r->ctl;
+    uint64_t head = ctl->head;
+    char *rec = r->data + (head & ctl->mask);
+    uint32_t size = *(uint32_t *)rec;
+    memset(rec, 0, size);
+    __atomic_store_n(&ctl->head, head + size, __ATOMIC_RELEASE);
+}
+
+static inline void shm_ring_wake_producers(shm_ring_t *r)
+{
+    shm_ring__notify(&r->ctl->producer_waiting, &r->ctl->space_seq, INT_MAX);
+}
+
+/* 释放 peek 得到的消息：清零后推进 head，必要时唤醒等待空间的生产者 */
+static inline void shm_ring_release(shm_ring_t *r)
+{
+    shm_ring_consume(r);
+    shm_ring_wake_producers(r);
+}
+
+/* 拷贝接收，返回消息长度；缓冲区不够时返回 -EMSGSIZE（消息保留在队列中） */
+static inline ssize_t shm_ring_recv(shm_ring_t *r, void *buf, size_t cap, int flags)
+{
+    uint32_t len;
+    const void *p = shm_ring_peek(r, &len, flags);
+    if (p == NULL)
+        return -errno;
+    if (len > cap)
+        return -EMSGSIZE;
+    memcpy(buf, p, len);
+    shm_ring_release(r);
+    return (ssize_t)len;
+}
+
+#endif
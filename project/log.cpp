@@ -1,38 +1,19 @@
 //当多个线程同时写入同一个日志文件时，可能会产生竞争条件，导致日志信息写入不完整或者出现重复。为了解决这个问题，可以实现一个线程安全的日志系统。下面是一个简单的实现：
+//
+// Logger 的实现见 log.h。同步模式每条日志加锁 + flush；异步模式下调用方只写本线程的
+// 环形缓冲区，由后台线程批量 write()，适合对调用延迟敏感的场景。
+//
+// 编译：g++ -std=c++11 log.cpp -o log -pthread -lz
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <mutex>
 #include <thread>
+#include <vector>
 
-class Logger {
-public:
-    static Logger& GetInstance() {
-        static Logger instance;
-        return instance;
-    }
-
-    void WriteLog(const std::string& message) {
-        std::lock_guard<std::mutex> guard(mutex_);
-        file_ << message << std::endl;
-    }
-
-private:
-    Logger() {
-        file_.open("log.txt", std::ios::out | std::ios::app);
-    }
-
-    ~Logger() {
-        file_.close();
-    }
-
-private:
-    std::mutex mutex_;
-    std::ofstream file_;
-};
+#include "log.h"
 
 int main() {
+    // 同步模式
     for (int i = 0; i < 5; ++i) {
         std::thread t([&]() {
             Logger& logger = Logger::GetInstance();
@@ -40,4 +21,42 @@ int main() {
         });
         t.join();
     }
-}
\ No newline at end of file
+
+    // 异步模式
+    AsyncOptions options;
+    options.policy = OverflowPolicy::Block;
+    options.rotate_bytes = 64 * 1024 * 1024;  // 每 64MB 切换一个文件
+    options.compress = true;                  // 旧文件在后台压缩成 .gz
+    options.keep_segments = 10;
+    options.sink = LogSink::Mmap;             // 写入预分配的映射区
+    options.sync_interval_ms = 1000;          // 每秒 fdatasync 一次
+    Logger::GetInstance().StartAsync(options);
+    Logger::GetInstance().InstallCrashHandler();  // 崩溃时把缓冲区中的日志写出再退出
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([i]() {
+            Logger& logger = Logger::GetInstance();
+            for (int j = 0; j < 1000; ++j)
+                logger.WriteLog("Async thread " + std::to_string(i) + " line " + std::to_string(j));
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    // 延迟格式化：调用方只拷贝参数，格式化由后台线程完成
+    for (int i = 0; i < 5; ++i)
+        LOG_FMT("Deferred record %d, ratio %.2f, tag %s", i, i / 3.0, "demo");
+
+    // 日志级别：默认 INFO，DEBUG 被过滤且参数不求值；可随时按模块调整
+    LOG_DEBUG("not written, %d", 1);
+    LOG_INFO("written at info level");
+    Logger::GetInstance().SetModuleLevel(LOG_MODULE, LOG_LEVEL_DEBUG);
+    LOG_DEBUG("written after lowering the module level, %d", 2);
+
+    // 屏障：确认之前的日志已经落盘
+    Logger::GetInstance().Flush(true);
+
+    Logger::GetInstance().StopAsync();
+    std::cout << "dropped: " << Logger::GetInstance().DroppedCount() << std::endl;
+}
@@ -0,0 +1,1668 @@
+// 线程安全的日志系统
+//
+// 同步模式：WriteLog 持有全局互斥锁，逐行写入 std::ofstream 并 flush（原实现）。
+// 异步模式：每个生产者线程拥有一个无锁 SPSC 环形缓冲区，WriteLog 只做一次 memcpy
+//          和一次 release store；唯一的后台线程轮询所有缓冲区，拼成大块后调用 write()。
+// 延迟格式化：LOG_FMT 只把格式串编号和原始参数写进缓冲区，格式化交给后台线程，
+//            或者以二进制写入 log.bin，由 log_decode 离线还原（NanoLog 的做法）。
+// 日志级别：低于 LOG_ACTIVE_LEVEL 的 LOG_DEBUG 等语句在编译期整体删除；其余语句先做
+//          一次 relaxed 原子读比较模块级别，被过滤时参数不会被求值。
+// 日志切分：后台线程按大小或时间把当前文件原子地 rename 成带时间戳的旧文件并打开新文件，
+//          旧文件交给一个低优先级线程用 zlib 压缩成 .gz，生产者线程完全不受影响。
+//          使用切分压缩时需要链接 -lz。
+// 输出方式：默认 write() 追加；也可以预分配文件并 mmap，后台线程直接 memcpy 进映射区，
+//          按 sync_interval_ms 周期性 fdatasync，在吞吐和持久性之间取舍。
+// 崩溃保护：Flush() 是显式屏障；InstallCrashHandler() 之后，收到 SIGSEGV / SIGABRT / SIGTERM
+//          等信号时在信号处理函数里只用 write/fdatasync 等系统调用把缓冲区中剩余的日志写出，
+//          然后按原来的处理方式重新触发信号（照常生成 core）。
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define LOG_CACHE_LINE 64
+
+// 日志级别，用宏定义以便在 #if 中使用
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_FATAL 5
+#define LOG_LEVEL_OFF   6
+#define LOG_LEVEL_NONE  (-1)  // LOG_FMT / WriteLog：不带级别，不参与过滤
+
+// 编译期级别：低于它的日志语句不生成任何代码，例如 -DLOG_ACTIVE_LEVEL=LOG_LEVEL_INFO
+#ifndef LOG_ACTIVE_LEVEL
+#define LOG_ACTIVE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// 本编译单元所属的模块名，在包含 log.h 之前定义，用于按模块调整运行期级别
+#ifndef LOG_MODULE
+#define LOG_MODULE "default"
+#endif
+
+inline const char* LogLevelName(int level) {
+    static const char* const names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF" };
+    return level >= 0 && level <= LOG_LEVEL_OFF ? names[level] : "";
+}
+
+// 级别名转数值，不区分大小写，无法识别时返回 -1
+inline int LogLevelFromName(const std::string& name) {
+    for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_OFF; ++level) {
+        const char* n = LogLevelName(level);
+        if (name.size() == strlen(n) && strncasecmp(name.c_str(), n, name.size()) == 0)
+            return level;
+    }
+    return -1;
+}
+
+// 缓冲区写满时的处理策略
+enum class OverflowPolicy {
+    Block,  // 自旋等待后台线程腾出空间（不丢日志）
+    Drop,   // 直接丢弃并计数（调用方延迟最稳定）
+    Grow    // 分配一个两倍大小的新缓冲区（不超过 max_buffer_size，超过后按 Drop 处理）
+};
+
+// 后台线程的输出方式
+enum class LogSink {
+    Write,  // write() 追加到文件，经过页缓存
+    Mmap    // 预分配文件并 mmap，记录 memcpy 进映射区，写入路径上没有系统调用
+};
+
+// 异步模式参数
+struct AsyncOptions {
+    size_t buffer_size;         // 每个线程环形缓冲区的初始大小，向上取整为 2 的幂
+    size_t max_buffer_size;     // Grow 策略下单个缓冲区的上限
+    size_t batch_size;          // 后台线程攒够多少字节调用一次 write()
+    int flush_interval_ms;      // 没有数据时后台线程的休眠间隔
+    OverflowPolicy policy;
+    bool binary;                // true 时不做格式化，原样写入 log.bin，用 log_decode 还原
+    const char* path;           // 日志文件名，NULL 时为 log.txt（binary 时为 log.bin）
+    size_t rotate_bytes;        // 当前文件达到该大小后切换新文件，0 表示不按大小切换
+    int rotate_seconds;         // 当前文件写满该秒数后切换新文件，0 表示不按时间切换
+    bool compress;              // 切换出来的旧文件压缩成 .gz
+    int keep_segments;          // 最多保留本进程切换出来的旧文件个数，0 表示不限
+    LogSink sink;
+    size_t mmap_window;         // Mmap 方式每次预分配并映射的大小
+    int sync_interval_ms;       // 每隔多久 fdatasync 一次，0 表示交给内核回写
+
+    AsyncOptions()
+        : buffer_size(64 * 1024), max_buffer_size(16 * 1024 * 1024),
+          batch_size(256 * 1024), flush_interval_ms(1), policy(OverflowPolicy::Block),
+          binary(false), path(NULL), rotate_bytes(0), rotate_seconds(0), compress(false),
+          keep_segments(0), sink(LogSink::Write), mmap_window(64 * 1024 * 1024),
+          sync_interval_ms(0) { }
+};
+
+// 单生产者单消费者字节环
+// 记录格式：[uint32 长度][数据]，按 4 字节对齐；尾部剩余空间不够时写入一个回绕标记，
+// 保证每条记录在内存中连续，消费者可以直接拿指针使用而不必再拷贝。
+class RingBuffer {
+public:
+    static const uint32_t kWrapMarker = 0xFFFFFFFFu;
+    static const size_t kHeaderSize = sizeof(uint32_t);
+
+    explicit RingBuffer(size_t capacity)
+        : head_(0), tail_(0), cached_head_(0), reserved_(0), next_(NULL) {
+        capacity_ = 64;
+        while (capacity_ < capacity)
+            capacity_ <<= 1;
+        mask_ = capacity_ - 1;
+        buf_ = new char[capacity_];
+    }
+
+    ~RingBuffer() { delete[] buf_; }
+
+    static size_t RecordSize(size_t len) { return kHeaderSize + ((len + 3) & ~size_t(3)); }
+
+    // 单条记录允许的最大长度（保证一定能放进一个空的环）
+    size_t MaxRecord() const { return capacity_ / 2 - kHeaderSize; }
+
+    // 生产者：预留 len 字节，成功返回数据区指针，之后必须调用 Commit
+    char* Reserve(uint32_t len) {
+        size_t need = RecordSize(len);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t pos = tail & mask_;
+        size_t contiguous = capacity_ - pos;
+        size_t total = need <= contiguous ? need : contiguous + need;
+
+        if (total > capacity_ - (tail - cached_head_)) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (total > capacity_ - (tail - cached_head_))
+                return NULL;
+        }
+        if (need > contiguous) {
+            // 尾部放不下，写回绕标记后从头开始
+            *reinterpret_cast<uint32_t*>(buf_ + pos) = kWrapMarker;
+            tail += contiguous;
+            pos = 0;
+        }
+        *reinterpret_cast<uint32_t*>(buf_ + pos) = len;
+        reserved_ = tail + need;
+        return buf_ + pos + kHeaderSize;
+    }
+
+    // 生产者：发布最近一次 Reserve 的记录
+    void Commit() { tail_.store(reserved_, std::memory_order_release); }
+
+    // 消费者：依次处理所有已发布的记录，f(const char* data, uint32_t len)
+    template <class F>
+    size_t Consume(F&& f) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (head != tail) {
+            size_t pos = head & mask_;
+            uint32_t len = *reinterpret_cast<const uint32_t*>(buf_ + pos);
+            if (len == kWrapMarker) {
+                head += capacity_ - pos;
+                continue;
+            }
+            f(buf_ + pos + kHeaderSize, len);
+            head += RecordSize(len);
+            ++n;
+        }
+        head_.store(head, std::memory_order_release);
+        return n;
+    }
+
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Grow 策略下由生产者设置，消费者读空本环后切换到 next
+    std::atomic<RingBuffer*>& next() { return next_; }
+
+private:
+    // 消费者独占的一行
+    std::atomic<size_t> head_;
+    char pad0_[LOG_CACHE_LINE - sizeof(std::atomic<size_t>)];
+    // 生产者独占的一行
+    std::atomic<size_t> tail_;
+    size_t cached_head_;
+    size_t reserved_;
+    char pad1_[LOG_CACHE_LINE - sizeof(std::atomic<size_t>) - 2 * sizeof(size_t)];
+
+    char* buf_;
+    size_t capacity_;
+    size_t mask_;
+    std::atomic<RingBuffer*> next_;
+};
+
+// 每个生产者线程对应的缓冲区，线程退出后归还给下一个新线程复用
+struct ThreadBuffer {
+    std::atomic<RingBuffer*> ring;      // 生产者当前写入的环
+    RingBuffer* reading;                // 消费者当前读取的环（仅后台线程访问）
+    std::atomic<bool> in_use;
+    std::atomic<uint64_t> dropped;
+    ThreadBuffer* next;                 // 全局链表，发布后不再修改
+
+    explicit ThreadBuffer(size_t size)
+        : ring(new RingBuffer(size)), reading(NULL), in_use(true), dropped(0), next(NULL) {
+        reading = ring.load(std::memory_order_relaxed);
+    }
+
+    ~ThreadBuffer() {
+        while (reading) {
+            RingBuffer* n = reading->next().load(std::memory_order_acquire);
+            delete reading;
+            reading = n;
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// 延迟格式化
+//
+// 每个 LOG_FMT 调用点第一次执行时登记一次格式串，得到编号 id；之后每次调用只写入
+// [uint32 id][参数...]。参数编码：整数 / 字符 / 指针 / 浮点统一为 8 字节，
+// 字符串为 [uint32 长度][字节]。id 为 0 的记录是 WriteLog 写入的纯文本。
+
+// 一个调用点的静态信息
+struct LogFormat {
+    const char* fmt;
+    const char* file;
+    int line;
+    int level;          // LOG_LEVEL_NONE 表示不输出级别前缀
+    std::string types;  // 每个参数一个类型字符，见 LogArgTag
+};
+
+// 参数类型字符：i 有符号整数，u 无符号整数，c 字符，d 浮点，s 字符串，p 指针
+template <class T>
+struct LogArgTag {
+    static const char value = std::is_floating_point<T>::value ? 'd'
+                            : std::is_pointer<T>::value ? 'p'
+                            : std::is_signed<T>::value ? 'i' : 'u';
+};
+template <> struct LogArgTag<char> { static const char value = 'c'; };
+template <> struct LogArgTag<const char*> { static const char value = 's'; };
+template <> struct LogArgTag<char*> { static const char value = 's'; };
+template <> struct LogArgTag<std::string> { static const char value = 's'; };
+
+template <class T, char Tag = LogArgTag<T>::value>
+struct LogArgCodec {
+    static size_t Size(const T&) { return 8; }
+    static char* Encode(char* p, const T& v) {
+        // 整数扩展到 64 位，浮点统一为 double
+        typedef typename std::conditional<Tag == 'd', double,
+                typename std::conditional<Tag == 'i' || Tag == 'c', int64_t, uint64_t>::type>::type Wide;
+        Wide w = static_cast<Wide>(v);
+        memcpy(p, &w, 8);
+        return p + 8;
+    }
+};
+
+template <class T>
+struct LogArgCodec<T, 'p'> {
+    static size_t Size(const T&) { return 8; }
+    static char* Encode(char* p, const T& v) {
+        uint64_t w = reinterpret_cast<uintptr_t>(v);
+        memcpy(p, &w, 8);
+        return p + 8;
+    }
+};
+
+template <class T>
+struct LogArgCodec<T, 's'> {
+    static const char* Data(const char* s) { return s ? s : "(null)"; }
+    static const char* Data(const std::string& s) { return s.data(); }
+    static size_t Length(const char* s) { return strlen(Data(s)); }
+    static size_t Length(const std::string& s) { return s.size(); }
+
+    static size_t Size(const T& v) { return sizeof(uint32_t) + Length(v); }
+    static char* Encode(char* p, const T& v) {
+        uint32_t n = static_cast<uint32_t>(Length(v));
+        memcpy(p, &n, sizeof(n));
+        memcpy(p + sizeof(n), Data(v), n);
+        return p + sizeof(n) + n;
+    }
+};
+
+inline size_t LogArgsSize() { return 0; }
+
+template <class T, class... Rest>
+size_t LogArgsSize(const T& v, const Rest&... rest) {
+    return LogArgCodec<typename std::decay<const T>::type>::Size(v) + LogArgsSize(rest...);
+}
+
+inline char* LogEncodeArgs(char* p) { return p; }
+
+template <class T, class... Rest>
+char* LogEncodeArgs(char* p, const T& v, const Rest&... rest) {
+    return LogEncodeArgs(LogArgCodec<typename std::decay<const T>::type>::Encode(p, v), rest...);
+}
+
+template <class... Args>
+std::string LogArgTypes() {
+    const char tags[] = { LogArgTag<typename std::decay<Args>::type>::value..., '\0' };
+    return tags;
+}
+
+// 追加一段 printf 格式化结果
+inline void LogAppendf(std::string& out, const char* spec, ...) {
+    char buf[128];
+    va_list ap;
+    va_start(ap, spec);
+    int n = vsnprintf(buf, sizeof(buf), spec, ap);
+    va_end(ap);
+    if (n < 0)
+        return;
+    if (static_cast<size_t>(n) < sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+    size_t old = out.size();
+    out.resize(old + n + 1);
+    va_start(ap, spec);
+    vsnprintf(&out[old], n + 1, spec, ap);
+    va_end(ap);
+    out.resize(old + n);
+}
+
+// 按格式串还原一条记录，追加到 out。
+// 支持 %[flags][width][.precision][length]conv，长度修饰符会按实际存储类型重写；
+// 不支持 '*' 宽度。参数不足时把剩余的转换说明原样输出。
+inline void LogFormatArgs(const LogFormat& format, const char* args, size_t len, std::string& out) {
+    const char* end = args + len;
+    const char* types = format.types.c_str();
+    const char* f = format.fmt;
+    char spec[32];
+
+    if (format.level != LOG_LEVEL_NONE) {
+        out.push_back('[');
+        out.append(LogLevelName(format.level));
+        out.append("] ");
+    }
+
+    while (*f) {
+        if (*f != '%') {
+            const char* s = f;
+            while (*f && *f != '%')
+                ++f;
+            out.append(s, f - s);
+            continue;
+        }
+        if (f[1] == '%') {
+            out.push_back('%');
+            f += 2;
+            continue;
+        }
+        const char* s = f++;
+        while (*f && strchr("-+ #0", *f))
+            ++f;
+        while (isdigit(static_cast<unsigned char>(*f)))
+            ++f;
+        if (*f == '.') {
+            ++f;
+            while (isdigit(static_cast<unsigned char>(*f)))
+                ++f;
+        }
+        size_t body = f - s;  // 去掉长度修饰符之前的部分，如 "%-08.3"
+        while (*f && strchr("hlLqjzt", *f))
+            ++f;
+        char conv = *f;
+        if (conv == '\0') {
+            out.append(s);
+            break;
+        }
+        ++f;
+
+        char tag = *types;
+        size_t need = tag == 's' ? sizeof(uint32_t) : 8;
+        if (tag == '\0' || body + 4 > sizeof(spec) || static_cast<size_t>(end - args) < need) {
+            out.append(s, f - s);
+            continue;
+        }
+        ++types;
+        memcpy(spec, s, body);
+        char* tail = spec + body;
+
+        if (tag == 's') {
+            uint32_t n;
+            memcpy(&n, args, sizeof(n));
+            args += sizeof(n);
+            if (n > static_cast<size_t>(end - args))
+                n = static_cast<uint32_t>(end - args);
+            if (body == 1) {
+                out.append(args, n);  // 最常见的 "%s"，不经过 snprintf
+            } else {
+                std::string str(args, n);
+                strcpy(tail, "s");
+                LogAppendf(out, spec, str.c_str());
+            }
+            args += n;
+            continue;
+        }
+
+        uint64_t raw;
+        memcpy(&raw, args, 8);
+        args += 8;
+        bool float_conv = strchr("eEfFgGaA", conv) != NULL;
+        if (tag == 'd') {
+            double v;
+            memcpy(&v, &raw, 8);
+            tail[0] = float_conv ? conv : 'g';
+            tail[1] = '\0';
+            LogAppendf(out, spec, v);
+        } else if (tag == 'p' || conv == 'p') {
+            strcpy(tail, "p");
+            LogAppendf(out, spec, reinterpret_cast<void*>(static_cast<uintptr_t>(raw)));
+        } else if (conv == 'c' || (tag == 'c' && conv == 's')) {
+            strcpy(tail, "c");
+            LogAppendf(out, spec, static_cast<int>(raw));
+        } else if (float_conv) {
+            tail[0] = conv;
+            tail[1] = '\0';
+            LogAppendf(out, spec, tag == 'u' ? static_cast<double>(raw)
+                                             : static_cast<double>(static_cast<int64_t>(raw)));
+        } else {
+            tail[0] = 'l';
+            tail[1] = 'l';
+            tail[2] = strchr("diouxX", conv) ? conv : (tag == 'u' ? 'u' : 'd');
+            tail[3] = '\0';
+            if (tail[2] == 'd' || tail[2] == 'i')
+                LogAppendf(out, spec, static_cast<long long>(raw));
+            else
+                LogAppendf(out, spec, static_cast<unsigned long long>(raw));
+        }
+    }
+}
+
+// 信号处理函数中使用的格式化：不分配内存、不调用 stdio，结果写入调用方提供的缓冲区，
+// 超出部分截断。支持与 LogFormatArgs 相同的转换，但忽略宽度和标志，浮点数按定点输出。
+class LogSafeFormatter {
+public:
+    LogSafeFormatter(char* buf, size_t cap) : buf_(buf), cap_(cap), len_(0) { }
+
+    size_t size() const { return len_; }
+
+    void Put(const char* s, size_t n) {
+        if (n > cap_ - len_)
+            n = cap_ - len_;
+        memcpy(buf_ + len_, s, n);
+        len_ += n;
+    }
+
+    void Put(const char* s) { Put(s, strlen(s)); }
+
+    void PutUnsigned(uint64_t v, unsigned base, bool upper) {
+        const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        char tmp[24];
+        int i = sizeof(tmp);
+        do {
+            tmp[--i] = digits[v % base];
+            v /= base;
+        } while (v != 0);
+        Put(tmp + i, sizeof(tmp) - i);
+    }
+
+    void PutSigned(int64_t v) {
+        if (v < 0) {
+            Put("-", 1);
+            PutUnsigned(0 - static_cast<uint64_t>(v), 10, false);
+        } else {
+            PutUnsigned(static_cast<uint64_t>(v), 10, false);
+        }
+    }
+
+    void PutDouble(double v, int precision) {
+        if (v != v) {
+            Put("nan");
+            return;
+        }
+        if (v < 0) {
+            Put("-", 1);
+            v = -v;
+        }
+        if (v >= 1e19) {
+            Put("inf");  // 超出 64 位整数范围，崩溃路径上不追求精确
+            return;
+        }
+        uint64_t scale = 1;
+        for (int i = 0; i < precision; ++i)
+            scale *= 10;
+        uint64_t ipart = static_cast<uint64_t>(v);
+        uint64_t fpart = static_cast<uint64_t>((v - ipart) * scale + 0.5);
+        if (fpart >= scale) {
+            ++ipart;
+            fpart -= scale;
+        }
+        PutUnsigned(ipart, 10, false);
+        if (precision > 0) {
+            char tmp[16];
+            for (int i = precision - 1; i >= 0; --i) {
+                tmp[i] = static_cast<char>('0' + fpart % 10);
+                fpart /= 10;
+            }
+            Put(".", 1);
+            Put(tmp, precision);
+        }
+    }
+
+    void Format(const LogFormat& format, const char* args, size_t len) {
+        const char* end = args + len;
+        const char* types = format.types.c_str();
+        if (format.level != LOG_LEVEL_NONE) {
+            Put("[");
+            Put(LogLevelName(format.level));
+            Put("] ");
+        }
+        for (const char* f = format.fmt; *f; ) {
+            if (*f != '%') {
+                const char* s = f;
+                while (*f && *f != '%')
+                    ++f;
+                Put(s, f - s);
+                continue;
+            }
+            if (f[1] == '%') {
+                Put("%", 1);
+                f += 2;
+                continue;
+            }
+            const char* s = f++;
+            int precision = 6;
+            while (*f && (strchr("-+ #0", *f) || isdigit(static_cast<unsigned char>(*f))))
+                ++f;
+            if (*f == '.') {
+                precision = 0;
+                for (++f; isdigit(static_cast<unsigned char>(*f)); ++f)
+                    precision = precision * 10 + (*f - '0');
+                if (precision > 9)
+                    precision = 9;
+            }
+            while (*f && strchr("hlLqjzt", *f))
+                ++f;
+            char conv = *f;
+            if (conv == '\0') {
+                Put(s);
+                return;
+            }
+            ++f;
+            char tag = *types;
+            size_t need = tag == 's' ? sizeof(uint32_t) : 8;
+            if (tag == '\0' || static_cast<size_t>(end - args) < need) {
+                Put(s, f - s);
+                continue;
+            }
+            ++types;
+            if (tag == 's') {
+                uint32_t n;
+                memcpy(&n, args, sizeof(n));
+                args += sizeof(n);
+                if (n > static_cast<size_t>(end - args))
+                    n = static_cast<uint32_t>(end - args);
+                Put(args, n);
+                args += n;
+                continue;
+            }
+            uint64_t raw;
+            memcpy(&raw, args, 8);
+            args += 8;
+            if (tag == 'd') {
+                double v;
+                memcpy(&v, &raw, 8);
+                PutDouble(v, precision);
+            } else if (tag == 'p' || conv == 'p') {
+                Put("0x", 2);
+                PutUnsigned(raw, 16, false);
+            } else if (conv == 'c' || (tag == 'c' && conv == 's')) {
+                char c = static_cast<char>(raw);
+                Put(&c, 1);
+            } else if (conv == 'x' || conv == 'X') {
+                PutUnsigned(raw, 16, conv == 'X');
+            } else if (conv == 'o') {
+                PutUnsigned(raw, 8, false);
+            } else if (tag == 'u' || conv == 'u') {
+                PutUnsigned(raw, 10, false);
+            } else {
+                PutSigned(static_cast<int64_t>(raw));
+            }
+        }
+    }
+
+private:
+    char* buf_;
+    size_t cap_;
+    size_t len_;
+};
+
+// log.bin 文件格式：
+//   文件头 "LOGBIN01"，之后是若干条 [uint32 id][uint32 长度][数据]。
+//   id == kLogDictionaryId 的记录登记格式串：
+//   [uint32 id][int32 line][int32 level][types\0][file\0][fmt\0]，
+//   保证出现在第一条使用该 id 的记录之前。
+static const char kLogBinaryMagic[8] = { 'L', 'O', 'G', 'B', 'I', 'N', '0', '1' };
+static const uint32_t kLogDictionaryId = 0xFFFFFFFFu;
+
+// 后台线程使用的日志文件，支持 write() 和 mmap 两种写法
+//
+// Mmap 方式按 window 大小分段预分配（posix_fallocate，磁盘满时在这里失败而不是写映射区时
+// 收到 SIGBUS）并映射，写满一段再映射下一段；Close 时把文件截断到实际长度。
+// 进程崩溃时文件停在预分配的整段末尾，尾部是没写过的 0 字节，下次以 Mmap 方式打开时找回实际长度。
+class LogFile {
+public:
+    LogFile()
+        : fd_(-1), sink_(LogSink::Write), window_(0), size_(0), map_(NULL), map_offset_(0),
+          map_size_(0), sync_interval_ms_(0), sync_count_(0), sync_ns_total_(0),
+          sync_ns_max_(0) { }
+
+    ~LogFile() { Close(); }
+
+    bool Open(const std::string& path, LogSink sink, size_t window, int sync_interval_ms) {
+        sink_ = sink;
+        sync_interval_ms_ = sync_interval_ms;
+        int flags = sink == LogSink::Mmap ? O_RDWR : (O_WRONLY | O_APPEND);
+        fd_ = ::open(path.c_str(), flags | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            return false;
+        struct stat st;
+        size_ = fstat(fd_, &st) == 0 ? st.st_size : 0;
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        window_ = (window + page - 1) / page * page;
+        if (window_ == 0)
+            window_ = page;
+        if (sink_ == LogSink::Mmap)
+            RecoverLength(page);
+        last_sync_ = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void Write(const char* data, size_t len) {
+        if (sink_ == LogSink::Write) {
+            WriteFd(data, len);
+            return;
+        }
+        while (len > 0) {
+            if (map_ == NULL || size_ == map_offset_ + map_size_) {
+                if (!MapWindow()) {
+                    WriteFd(data, len);  // 预分配失败时退回 write()
+                    return;
+                }
+            }
+            size_t pos = size_ - map_offset_;
+            size_t n = std::min(len, map_size_ - pos);
+            memcpy(map_ + pos, data, n);
+            size_ += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    // 把已经写入的数据刷到磁盘。映射区的脏页同样由 fdatasync 写回。
+    void Sync() {
+        if (fd_ < 0)
+            return;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ::fdatasync(fd_);
+        last_sync_ = std::chrono::steady_clock::now();
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(last_sync_ - start).count();
+        ++sync_count_;
+        sync_ns_total_ += ns;
+        if (ns > sync_ns_max_)
+            sync_ns_max_ = ns;
+    }
+
+    // 距离上次 Sync 超过 sync_interval_ms 时执行一次
+    void MaybeSync() {
+        if (sync_interval_ms_ > 0 && std::chrono::steady_clock::now() - last_sync_ >=
+                                         std::chrono::milliseconds(sync_interval_ms_))
+            Sync();
+    }
+
+    void Close() {
+        if (fd_ < 0)
+            return;
+        if (sync_interval_ms_ > 0)
+            Sync();
+        if (map_ != NULL) {
+            munmap(map_, map_size_);
+            map_ = NULL;
+        }
+        if (sink_ == LogSink::Mmap)
+            ::ftruncate(fd_, size_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    size_t size() const { return size_; }
+    uint64_t sync_count() const { return sync_count_; }
+    uint64_t sync_ns_total() const { return sync_ns_total_; }
+    uint64_t sync_ns_max() const { return sync_ns_max_; }
+
+private:
+    LogFile(const LogFile&);
+    LogFile& operator=(const LogFile&);
+
+    void WriteFd(const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::write(fd_, data, len);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;  // 磁盘错误时丢弃本批，不阻塞生产者
+            }
+            data += n;
+            len -= n;
+            size_ += n;
+        }
+    }
+
+    bool MapWindow() {
+        if (map_ != NULL) {
+            munmap(map_, map_size_);
+            map_ = NULL;
+        }
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        map_offset_ = size_ / page * page;
+        map_size_ = window_;
+        if (posix_fallocate(fd_, map_offset_, map_size_) != 0)
+            return false;
+        void* p = mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, map_offset_);
+        if (p == MAP_FAILED)
+            return false;
+        map_ = static_cast<char*>(p);
+        return true;
+    }
+
+    // 上次异常退出时文件长度是映射段的末尾，一定是页的整数倍；正常 Close 截断后的长度
+    // 不是页的整数倍时不用检查。二进制日志的记录里本来就可能有 0 字节，不能按尾部的 0 猜长度，
+    // 而是从文件头开始逐条跳过记录，直到没写过的区域（id 为 0）或不完整的记录。
+    void RecoverLength(size_t page) {
+        if (size_ == 0 || size_ % page != 0)
+            return;
+        char magic[sizeof(kLogBinaryMagic)];
+        bool binary = ::pread(fd_, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) &&
+                      memcmp(magic, kLogBinaryMagic, sizeof(magic)) == 0;
+        size_t end = binary ? BinaryEnd() : TextEnd();
+        if (end != size_ && ::ftruncate(fd_, end) == 0)
+            size_ = end;
+    }
+
+    // 二进制日志：记录是 [uint32 id][uint32 长度][数据]，id 从 1 开始，0 只会出现在预分配区域
+    size_t BinaryEnd() const {
+        size_t pos = sizeof(kLogBinaryMagic);
+        uint32_t head[2];
+        while (size_ - pos >= sizeof(head)) {
+            if (::pread(fd_, head, sizeof(head), pos) != static_cast<ssize_t>(sizeof(head)))
+                return size_;  // 读失败时不截断
+            if (head[0] == 0 || head[1] > size_ - pos - sizeof(head))
+                break;
+            pos += sizeof(head) + head[1];
+        }
+        return pos;
+    }
+
+    // 文本日志不含 '\0'，去掉尾部的 0 字节即可
+    size_t TextEnd() const {
+        char buf[64 * 1024];
+        size_t end = size_;
+        while (end > 0) {
+            size_t n = std::min(end, sizeof(buf));
+            if (::pread(fd_, buf, n, end - n) != static_cast<ssize_t>(n))
+                return size_;
+            size_t i = n;
+            while (i > 0 && buf[i - 1] == '\0')
+                --i;
+            end -= n - i;
+            if (i > 0)
+                break;
+        }
+        return end;
+    }
+
+    int fd_;
+    LogSink sink_;
+    size_t window_;
+    size_t size_;           // 文件逻辑长度（已写入的字节数）
+    char* map_;
+    size_t map_offset_;
+    size_t map_size_;
+    int sync_interval_ms_;
+    std::chrono::steady_clock::time_point last_sync_;
+    uint64_t sync_count_;
+    uint64_t sync_ns_total_;
+    uint64_t sync_ns_max_;
+};
+
+class LogModule;
+
+class Logger {
+public:
+    static Logger& GetInstance() {
+        static Logger instance;
+        return instance;
+    }
+
+    void WriteLog(const std::string& message) {
+        WriteLog(message.data(), message.size());
+    }
+
+    void WriteLog(const char* message, size_t len) {
+        if (async_.load(std::memory_order_relaxed)) {
+            RingBuffer* ring;
+            size_t size = sizeof(uint32_t) + len;
+            char* p = ReserveRecord(size, true, ring);
+            if (p == NULL)
+                return;
+            uint32_t id = 0;
+            memcpy(p, &id, sizeof(id));
+            memcpy(p + sizeof(id), message, size - sizeof(id));
+            ring->Commit();
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!file_.is_open())
+            file_.open("log.txt", std::ios::out | std::ios::app);
+        file_.write(message, len);
+        file_ << std::endl;
+    }
+
+    // 结构化日志，一般通过 LOG_FMT 宏调用。
+    // 异步模式下调用方只做参数拷贝，不做任何格式化；同步模式下立即格式化并写入。
+    template <class... Args>
+    void Log(std::atomic<uint32_t>& site, int level, const char* fmt, const char* file, int line,
+             const Args&... args) {
+        // acquire 与 RegisterFormat 的 release 配对，看到编号就能看到登记好的格式串
+        uint32_t id = site.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = RegisterFormat(site, level, fmt, file, line, LogArgTypes<Args...>());
+            if (id == 0)
+                return;  // 登记表已满，丢弃这条日志
+        }
+        size_t size = sizeof(uint32_t) + LogArgsSize(args...);
+
+        if (async_.load(std::memory_order_relaxed)) {
+            RingBuffer* ring;
+            char* p = ReserveRecord(size, false, ring);
+            if (p == NULL)
+                return;
+            memcpy(p, &id, sizeof(id));
+            LogEncodeArgs(p + sizeof(id), args...);
+            ring->Commit();
+            return;
+        }
+        std::string encoded(size - sizeof(id), '\0');
+        LogEncodeArgs(&encoded[0], args...);
+        std::string message;
+        LogFormatArgs(FormatAt(id), encoded.data(), encoded.size(), message);
+        WriteLog(message);
+    }
+
+    // 登记一个调用点的格式串，返回编号（从 1 开始）
+    uint32_t RegisterFormat(std::atomic<uint32_t>& site, int level, const char* fmt,
+                            const char* file, int line, const std::string& types) {
+        std::lock_guard<std::mutex> guard(format_mutex_);
+        uint32_t id = site.load(std::memory_order_relaxed);
+        if (id != 0)
+            return id;
+        uint32_t index = format_count_.load(std::memory_order_relaxed);
+        if (index >= kMaxFormatChunks * kFormatChunkSize)
+            return 0;  // 登记表已满，调用方丢弃日志
+        LogFormat*& chunk = format_chunks_[index / kFormatChunkSize];
+        if (chunk == NULL)
+            chunk = new LogFormat[kFormatChunkSize];
+        LogFormat& format = chunk[index % kFormatChunkSize];
+        format.fmt = fmt;
+        format.file = file;
+        format.line = line;
+        format.level = level;
+        format.types = types;
+        format_count_.store(index + 1, std::memory_order_release);
+        site.store(index + 1, std::memory_order_release);
+        return index + 1;
+    }
+
+    // 按编号取格式串，id 必须来自 RegisterFormat（非 0）。
+    // 后台线程从环形缓冲区读到 id 时，经由调用方对 site 的 acquire 和 Commit / Drain 的
+    // release / acquire，登记时写入的内容对它可见
+    const LogFormat& FormatAt(uint32_t id) const {
+        uint32_t index = id - 1;
+        return format_chunks_[index / kFormatChunkSize][index % kFormatChunkSize];
+    }
+
+    // 开启异步模式，调用前已经写入的同步日志不受影响
+    bool StartAsync(const AsyncOptions& options = AsyncOptions()) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (async_.load(std::memory_order_relaxed))
+            return true;
+        options_ = options;
+        path_ = options.path ? options.path : (options.binary ? "log.bin" : "log.txt");
+        if (!OpenSegment())
+            return false;
+        file_.flush();
+        running_.store(true, std::memory_order_relaxed);
+        writer_ = std::thread(&Logger::WriterLoop, this);
+        if (options_.compress || options_.keep_segments > 0) {
+            archiver_stop_ = false;
+            archiver_ = std::thread(&Logger::ArchiverLoop, this);
+        }
+        async_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // 关闭异步模式：写完所有缓冲区中的日志后返回。
+    // 调用方需保证此时没有线程仍在 WriteLog。
+    void StopAsync() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!async_.load(std::memory_order_relaxed))
+            return;
+        async_.store(false, std::memory_order_relaxed);
+        running_.store(false, std::memory_order_release);
+        wakeup_.notify_one();
+        writer_.join();
+        out_.Close();
+        {
+            // 后台线程退出后到达的 Flush 不会再被处理，直接放行
+            std::lock_guard<std::mutex> lock(wakeup_mutex_);
+            flush_done_ = flush_requested_.load(std::memory_order_relaxed);
+        }
+        flush_cond_.notify_all();
+        if (archiver_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(archive_mutex_);
+                archiver_stop_ = true;
+            }
+            archive_cond_.notify_one();
+            archiver_.join();
+        }
+    }
+
+    // 屏障：返回时，调用前已经提交的日志都已经交给文件（write() 或映射区），
+    // durable 为 true 时还会 fdatasync。不影响其他线程继续写日志。
+    void Flush(bool durable = false) {
+        if (!async_.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> guard(mutex_);
+            file_.flush();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wakeup_mutex_);
+        uint64_t target = flush_requested_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        if (durable)
+            flush_durable_ = target;
+        wakeup_.notify_one();
+        while (flush_done_ < target)
+            flush_cond_.wait(lock);
+    }
+
+    // 安装崩溃信号处理函数，并为调用线程设置备用信号栈（栈溢出引起的 SIGSEGV 也能处理）。
+    // 其他线程如需处理自身的栈溢出，可以各自调用 InstallSignalStack。
+    // 重复调用只补设调用线程的信号栈：再次 sigaction 会把自己的处理函数存进 old_actions_，
+    // 崩溃时恢复后 raise 又回到自己，无限循环。
+    bool InstallCrashHandler() {
+        static const int signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM };
+        static std::mutex install_mutex;
+        static bool installed = false;
+        InstallSignalStack();
+        std::lock_guard<std::mutex> guard(install_mutex);
+        if (installed)
+            return true;
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = &Logger::OnCrashSignal;
+        sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigfillset(&sa.sa_mask);
+        for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+            if (sigaction(signals[i], &sa, &old_actions_[signals[i]]) != 0)
+                return false;
+        }
+        installed = true;
+        return true;
+    }
+
+    static bool InstallSignalStack() {
+        static thread_local char* stack = NULL;
+        if (stack != NULL)
+            return true;
+        stack_t ss;
+        ss.ss_size = 64 * 1024;
+        ss.ss_sp = stack = new char[ss.ss_size];
+        ss.ss_flags = 0;
+        return sigaltstack(&ss, NULL) == 0;
+    }
+
+    // 因缓冲区满被丢弃的日志条数
+    uint64_t DroppedCount() const {
+        uint64_t n = 0;
+        for (ThreadBuffer* b = buffers_.load(std::memory_order_acquire); b; b = b->next)
+            n += b->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // 运行期全局级别，没有单独设置过的模块都跟随它
+    void SetLevel(int level) {
+        std::lock_guard<std::mutex> guard(level_mutex_);
+        global_level_ = level;
+        ApplyLevels();
+    }
+
+    int GetLevel() {
+        std::lock_guard<std::mutex> guard(level_mutex_);
+        return global_level_;
+    }
+
+    // 单独设置某个模块的级别，立即对所有线程生效
+    void SetModuleLevel(const std::string& module, int level) {
+        std::lock_guard<std::mutex> guard(level_mutex_);
+        overrides_[module] = level;
+        ApplyLevels();
+    }
+
+    // 取消模块的单独设置，恢复跟随全局级别
+    void ResetModuleLevel(const std::string& module) {
+        std::lock_guard<std::mutex> guard(level_mutex_);
+        overrides_.erase(module);
+        ApplyLevels();
+    }
+
+    // 按 "info,net=debug,db=warn" 形式的配置串设置级别，不带模块名的一项是全局级别。
+    // 可以在收到配置更新或信号后调用，无需重启；遇到无法识别的级别返回 false，已解析的项仍生效。
+    bool SetLevels(const std::string& spec) {
+        bool ok = true;
+        size_t begin = 0;
+        while (begin <= spec.size()) {
+            size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+                end = spec.size();
+            std::string item = spec.substr(begin, end - begin);
+            begin = end + 1;
+            if (item.empty())
+                continue;
+            size_t eq = item.find('=');
+            int level = LogLevelFromName(eq == std::string::npos ? item : item.substr(eq + 1));
+            if (level < 0) {
+                ok = false;
+                continue;
+            }
+            if (eq == std::string::npos)
+                SetLevel(level);
+            else
+                SetModuleLevel(item.substr(0, eq), level);
+        }
+        return ok;
+    }
+
+    void AttachModule(LogModule* module);
+    void DetachModule(LogModule* module);
+
+private:
+    Logger()
+        : async_(false), running_(false), buffers_(NULL), segment_base_(0), segment_start_(0),
+          rotate_due_(false), archiver_stop_(false), flush_requested_(0), flush_durable_(0),
+          flush_done_(0), flush_synced_(0), drain_lock_(false), drain_owner_(0), format_count_(0),
+          global_level_(LOG_LEVEL_INFO) {
+        for (size_t i = 0; i < kMaxFormatChunks; ++i)
+            format_chunks_[i] = NULL;
+    }
+
+    ~Logger() {
+        StopAsync();
+        file_.close();
+        ThreadBuffer* b = buffers_.load(std::memory_order_relaxed);
+        while (b) {
+            ThreadBuffer* n = b->next;
+            delete b;
+            b = n;
+        }
+        for (size_t i = 0; i < kMaxFormatChunks; ++i)
+            delete[] format_chunks_[i];
+    }
+
+    Logger(const Logger&);
+    Logger& operator=(const Logger&);
+
+    // 线程退出时把缓冲区标记为空闲，剩余数据仍由后台线程写出
+    struct ThreadBufferHolder {
+        ThreadBuffer* buffer;
+        ThreadBufferHolder() : buffer(NULL) { }
+        ~ThreadBufferHolder() {
+            if (buffer)
+                buffer->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    ThreadBuffer* LocalBuffer() {
+        static thread_local ThreadBufferHolder holder;
+        if (holder.buffer)
+            return holder.buffer;
+
+        // 优先复用已退出线程留下的缓冲区
+        for (ThreadBuffer* b = buffers_.load(std::memory_order_acquire); b; b = b->next) {
+            bool expected = false;
+            if (b->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                holder.buffer = b;
+                return b;
+            }
+        }
+        ThreadBuffer* b = new ThreadBuffer(options_.buffer_size);
+        ThreadBuffer* head = buffers_.load(std::memory_order_relaxed);
+        do {
+            b->next = head;
+        } while (!buffers_.compare_exchange_weak(head, b, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        holder.buffer = b;
+        return b;
+    }
+
+    // 在本线程缓冲区中预留一条记录，返回 NULL 表示按策略丢弃；成功时通过 ring 返回所在的环。
+    // 超长的文本记录截断，二进制记录截断后无法解码，直接丢弃。
+    char* ReserveRecord(size_t& len, bool truncate, RingBuffer*& ring) {
+        ThreadBuffer* tb = LocalBuffer();
+        ring = tb->ring.load(std::memory_order_relaxed);
+        if (len > ring->MaxRecord() && options_.policy != OverflowPolicy::Grow) {
+            if (!truncate) {
+                tb->dropped.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            }
+            len = ring->MaxRecord();
+        }
+
+        for (;;) {
+            char* p = ring->Reserve(static_cast<uint32_t>(len));
+            if (p != NULL)
+                return p;
+            switch (options_.policy) {
+            case OverflowPolicy::Drop:
+                tb->dropped.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            case OverflowPolicy::Grow:
+                if (ring->capacity() * 2 > options_.max_buffer_size) {
+                    tb->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return NULL;
+                }
+                ring = Grow(tb, ring);
+                break;
+            case OverflowPolicy::Block:
+                wakeup_.notify_one();
+                std::this_thread::yield();
+                break;
+            }
+        }
+    }
+
+    RingBuffer* Grow(ThreadBuffer* tb, RingBuffer* old) {
+        RingBuffer* ring = new RingBuffer(old->capacity() * 2);
+        old->next().store(ring, std::memory_order_release);
+        tb->ring.store(ring, std::memory_order_relaxed);
+        return ring;
+    }
+
+    // 取出一个缓冲区中的全部记录，追加到 batch
+    size_t Drain(ThreadBuffer* tb, std::string& batch) {
+        size_t n = 0;
+        for (;;) {
+            RingBuffer* ring = tb->reading;
+            RingBuffer* next = ring->next().load(std::memory_order_acquire);
+            n += ring->Consume([&](const char* data, uint32_t len) {
+                Emit(data, len, batch);
+                if (batch.size() >= options_.batch_size)
+                    WriteOut(batch);
+            });
+            // 看到 next 之后再读一遍仍为空，说明生产者已经彻底切换到新环
+            if (next == NULL || !ring->Empty())
+                return n;
+            tb->reading = next;
+            delete ring;
+        }
+    }
+
+    // 把一条缓冲区记录转成输出格式：文本模式下格式化成一行，二进制模式下原样加帧
+    void Emit(const char* data, uint32_t len, std::string& batch) {
+        // 只在记录边界切换文件，保证二进制文件的字典总在记录之前
+        if (rotate_due_ || (options_.rotate_bytes > 0 &&
+                            out_.size() + batch.size() >= options_.rotate_bytes &&
+                            out_.size() + batch.size() > segment_base_)) {
+            WriteOut(batch);
+            Rotate();
+        }
+        uint32_t id;
+        memcpy(&id, data, sizeof(id));
+        const char* args = data + sizeof(id);
+        size_t args_len = len - sizeof(id);
+
+        if (!options_.binary) {
+            if (id == 0)
+                batch.append(args, args_len);
+            else
+                LogFormatArgs(FormatAt(id), args, args_len, batch);
+            batch.push_back('\n');
+            return;
+        }
+        if (id != 0) {
+            if (id >= emitted_.size())
+                emitted_.resize(format_count_.load(std::memory_order_acquire) + 1, false);
+            if (!emitted_[id]) {
+                AppendDictionary(id, batch);
+                emitted_[id] = true;
+            }
+        }
+        AppendFrame(id, args, args_len, batch);
+    }
+
+    static void AppendFrame(uint32_t id, const char* data, size_t len, std::string& batch) {
+        uint32_t head[2] = { id, static_cast<uint32_t>(len) };
+        batch.append(reinterpret_cast<const char*>(head), sizeof(head));
+        batch.append(data, len);
+    }
+
+    void AppendDictionary(uint32_t id, std::string& batch) {
+        const LogFormat& format = FormatAt(id);
+        std::string entry(reinterpret_cast<const char*>(&id), sizeof(id));
+        int32_t meta[2] = { format.line, format.level };
+        entry.append(reinterpret_cast<const char*>(meta), sizeof(meta));
+        entry.append(format.types.c_str(), format.types.size() + 1);
+        entry.append(format.file, strlen(format.file) + 1);
+        entry.append(format.fmt, strlen(format.fmt) + 1);
+        AppendFrame(kLogDictionaryId, entry.data(), entry.size(), batch);
+    }
+
+    void WriteOut(std::string& batch) {
+        out_.Write(batch.data(), batch.size());
+        batch.clear();
+    }
+
+    // 打开（或续写）当前日志文件
+    bool OpenSegment() {
+        if (!out_.Open(path_, options_.sink, options_.mmap_window, options_.sync_interval_ms))
+            return false;
+        segment_start_ = time(NULL);
+        rotate_due_ = false;
+        emitted_.assign(format_count_.load(std::memory_order_acquire) + 1, false);
+        if (options_.binary && out_.size() == 0) {
+            std::string header(kLogBinaryMagic, sizeof(kLogBinaryMagic));
+            WriteOut(header);
+        }
+        segment_base_ = out_.size();
+        return true;
+    }
+
+    // 旧文件名：<path>.<YYYYmmdd-HHMMSS>[.N]
+    std::string SegmentName() const {
+        char stamp[32];
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+        std::string base = path_ + "." + stamp;
+        std::string name = base;
+        for (int i = 1; access(name.c_str(), F_OK) == 0 ||
+                        access((name + ".gz").c_str(), F_OK) == 0; ++i)
+            name = base + "." + std::to_string(i);
+        return name;
+    }
+
+    // 由后台线程调用：rename 是原子的，任何时刻 path_ 要么是旧文件要么是新文件
+    void Rotate() {
+        std::string name = SegmentName();
+        bool renamed = ::rename(path_.c_str(), name.c_str()) == 0;
+        out_.Close();
+        if (!OpenSegment()) {
+            // 打不开新文件时退回旧文件继续写，避免丢日志
+            if (renamed)
+                ::rename(name.c_str(), path_.c_str());
+            OpenSegment();
+            return;
+        }
+        if (renamed && archiver_.joinable()) {
+            std::lock_guard<std::mutex> lock(archive_mutex_);
+            archive_queue_.push_back(name);
+            archive_cond_.notify_one();
+        }
+    }
+
+    // 压缩线程：降到最低 CPU 和 IO 优先级，压缩旧文件并清理超出保留数量的旧文件
+    void ArchiverLoop() {
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        setpriority(PRIO_PROCESS, tid, 19);
+        syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, tid, 3 << 13 /* IOPRIO_CLASS_IDLE */);
+
+        std::deque<std::string> segments;
+        for (;;) {
+            std::string name;
+            {
+                std::unique_lock<std::mutex> lock(archive_mutex_);
+                while (archive_queue_.empty() && !archiver_stop_)
+                    archive_cond_.wait(lock);
+                if (archive_queue_.empty())
+                    return;
+                name = archive_queue_.front();
+                archive_queue_.pop_front();
+            }
+            if (options_.compress && CompressFile(name))
+                name += ".gz";
+            segments.push_back(name);
+            while (options_.keep_segments > 0 &&
+                   segments.size() > static_cast<size_t>(options_.keep_segments)) {
+                ::unlink(segments.front().c_str());
+                segments.pop_front();
+            }
+        }
+    }
+
+    // 把 name 压缩为 name.gz，成功后删除原文件
+    static bool CompressFile(const std::string& name) {
+        int in = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0)
+            return false;
+        std::string gz_name = name + ".gz";
+        gzFile out = gzopen(gz_name.c_str(), "wb6");
+        if (out == NULL) {
+            ::close(in);
+            return false;
+        }
+        char buf[64 * 1024];
+        bool ok = true;
+        for (;;) {
+            ssize_t n = ::read(in, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                ok = n == 0;
+                break;
+            }
+            if (gzwrite(out, buf, static_cast<unsigned>(n)) != n) {
+                ok = false;
+                break;
+            }
+        }
+        ::close(in);
+        ok = gzclose(out) == Z_OK && ok;
+        if (ok)
+            ::unlink(name.c_str());
+        else
+            ::unlink(gz_name.c_str());
+        return ok;
+    }
+
+    void WriterLoop() {
+        std::string batch;
+        batch.reserve(options_.batch_size + 4096);
+        for (;;) {
+            bool stopping = !running_.load(std::memory_order_acquire);
+            uint64_t flush_request, durable_request;
+            {
+                // 本轮开始时的请求序号：序号不超过它的 Flush 调用之前提交的日志都会在本轮写出
+                std::lock_guard<std::mutex> lock(wakeup_mutex_);
+                flush_request = flush_requested_.load(std::memory_order_relaxed);
+                durable_request = flush_durable_;
+            }
+            size_t n = 0;
+
+            LockDrain();
+            for (ThreadBuffer* b = buffers_.load(std::memory_order_acquire); b; b = b->next)
+                n += Drain(b, batch);
+            if (!batch.empty())
+                WriteOut(batch);
+            if (durable_request > flush_synced_) {
+                out_.Sync();
+                flush_synced_ = flush_request;
+            } else
+                out_.MaybeSync();
+            if (options_.rotate_seconds > 0 && time(NULL) - segment_start_ >= options_.rotate_seconds)
+                rotate_due_ = true;
+            if (rotate_due_ && out_.size() > segment_base_)
+                Rotate();
+            UnlockDrain();
+
+            std::unique_lock<std::mutex> lock(wakeup_mutex_);
+            if (flush_request > flush_done_) {
+                flush_done_ = flush_request;
+                flush_cond_.notify_all();
+            }
+            if (stopping)
+                break;
+            if (n == 0 && flush_requested_.load(std::memory_order_relaxed) == flush_done_)
+                wakeup_.wait_for(lock, std::chrono::milliseconds(options_.flush_interval_ms));
+        }
+    }
+
+    // 后台线程每一轮和崩溃处理函数互斥地访问环形缓冲区与输出文件
+    void LockDrain() {
+        while (drain_lock_.exchange(true, std::memory_order_acquire)) {
+            struct timespec ts = { 0, 50 * 1000 };
+            nanosleep(&ts, NULL);
+        }
+        drain_owner_.store(static_cast<pid_t>(syscall(SYS_gettid)), std::memory_order_relaxed);
+    }
+
+    void UnlockDrain() {
+        drain_owner_.store(0, std::memory_order_relaxed);
+        drain_lock_.store(false, std::memory_order_release);
+    }
+
+    // 以下在信号处理函数中执行，只能使用异步信号安全的操作：不加锁、不分配内存、不用 stdio
+    static void OnCrashSignal(int sig, siginfo_t*, void*) {
+        static std::atomic<bool> handling(false);
+        Logger& logger = GetInstance();
+        if (!handling.exchange(true) && logger.async_.load(std::memory_order_acquire))
+            logger.CrashDrain();
+
+        // 恢复原来的处理方式后重新触发，保持原有的退出码和 core dump 行为
+        sigaction(sig, &logger.old_actions_[sig], NULL);
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, sig);
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        raise(sig);
+    }
+
+    void CrashDrain() {
+        // 等后台线程写完当前一轮（最多约 100ms）；崩溃发生在后台线程自身时直接接管
+        pid_t self = static_cast<pid_t>(syscall(SYS_gettid));
+        for (int i = 0; i < 2000 && drain_owner_.load(std::memory_order_relaxed) != self; ++i) {
+            if (!drain_lock_.exchange(true, std::memory_order_acquire))
+                break;
+            struct timespec ts = { 0, 50 * 1000 };
+            nanosleep(&ts, NULL);
+        }
+
+        static char buffer[64 * 1024];
+        size_t used = 0;
+        for (ThreadBuffer* b = buffers_.load(std::memory_order_acquire); b; b = b->next) {
+            for (RingBuffer* ring = b->reading; ring != NULL;
+                 ring = ring->next().load(std::memory_order_acquire)) {
+                ring->Consume([&](const char* data, uint32_t len) {
+                    if (len + 1024 > sizeof(buffer) - used) {
+                        out_.Write(buffer, used);
+                        used = 0;
+                    }
+                    used += CrashEmit(data, len, buffer + used, sizeof(buffer) - used);
+                });
+            }
+        }
+        out_.Write(buffer, used);
+        out_.Sync();
+    }
+
+    // 把一条记录写成输出格式放进 out，返回写入的字节数（超出 cap 的部分截断）
+    size_t CrashEmit(const char* data, uint32_t len, char* out, size_t cap) {
+        uint32_t id;
+        memcpy(&id, data, sizeof(id));
+        const char* args = data + sizeof(id);
+        size_t args_len = len - sizeof(id);
+        LogSafeFormatter w(out, cap);
+
+        if (!options_.binary) {
+            if (id == 0)
+                w.Put(args, args_len);
+            else
+                w.Format(FormatAt(id), args, args_len);
+            w.Put("\n", 1);
+            return w.size();
+        }
+        if (id != 0 && (id >= emitted_.size() || !emitted_[id])) {
+            // 字典记录直接拼在缓冲区里；重复写出同一个字典项不影响解码
+            const LogFormat& format = FormatAt(id);
+            size_t types_len = format.types.size() + 1;
+            size_t file_len = strlen(format.file) + 1;
+            size_t fmt_len = strlen(format.fmt) + 1;
+            uint32_t head[2] = { kLogDictionaryId, static_cast<uint32_t>(
+                sizeof(id) + 2 * sizeof(int32_t) + types_len + file_len + fmt_len) };
+            int32_t meta[2] = { format.line, format.level };
+            w.Put(reinterpret_cast<const char*>(head), sizeof(head));
+            w.Put(reinterpret_cast<const char*>(&id), sizeof(id));
+            w.Put(reinterpret_cast<const char*>(meta), sizeof(meta));
+            w.Put(format.types.c_str(), types_len);
+            w.Put(format.file, file_len);
+            w.Put(format.fmt, fmt_len);
+        }
+        uint32_t head[2] = { id, static_cast<uint32_t>(args_len) };
+        w.Put(reinterpret_cast<const char*>(head), sizeof(head));
+        w.Put(args, args_len);
+        return w.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::ofstream file_;
+
+    std::atomic<bool> async_;
+    std::atomic<bool> running_;
+    std::atomic<ThreadBuffer*> buffers_;
+    AsyncOptions options_;
+    std::thread writer_;
+
+    // 当前文件的状态，仅后台线程访问
+    LogFile out_;
+    std::string path_;
+    size_t segment_base_;       // 打开时的大小（含二进制文件头），没有新数据时不切换
+    time_t segment_start_;
+    bool rotate_due_;
+
+    // 旧文件压缩队列
+    std::thread archiver_;
+    std::mutex archive_mutex_;
+    std::condition_variable archive_cond_;
+    std::deque<std::string> archive_queue_;
+    bool archiver_stop_;
+    std::mutex wakeup_mutex_;
+    std::condition_variable wakeup_;
+
+    // Flush 屏障：请求序号递增，后台线程完成一整轮后把 flush_done_ 推进到本轮开始时的请求序号
+    std::atomic<uint64_t> flush_requested_;
+    uint64_t flush_durable_;    // 最近一次 durable 请求的序号，由 wakeup_mutex_ 保护
+    uint64_t flush_done_;       // 由 wakeup_mutex_ 保护
+    uint64_t flush_synced_;     // 已被 fdatasync 覆盖的请求序号，只由后台线程访问
+    std::condition_variable flush_cond_;
+
+    // 崩溃处理
+    std::atomic<bool> drain_lock_;
+    std::atomic<pid_t> drain_owner_;
+    struct sigaction old_actions_[NSIG];
+
+    // 格式串登记表：按块分配，块一旦分配不再移动，后台线程可以无锁读取
+    static const size_t kFormatChunkSize = 1024;
+    static const size_t kMaxFormatChunks = 256;
+    std::mutex format_mutex_;
+    std::atomic<uint32_t> format_count_;
+    LogFormat* format_chunks_[kMaxFormatChunks];
+    std::vector<bool> emitted_;  // 二进制模式下已经写出过字典的格式串（仅后台线程访问）
+
+    // 运行期级别：每个模块对象保存自己的生效级别，修改时在这里统一刷新
+    void ApplyLevels();
+    std::mutex level_mutex_;
+    int global_level_;
+    std::map<std::string, int> overrides_;
+    std::multimap<std::string, LogModule*> modules_;
+};
+
+// 模块句柄：每个包含 log.h 的编译单元一个，日志宏只读取其中的原子级别
+class LogModule {
+public:
+    explicit LogModule(const char* name) : name_(name), level_(LOG_LEVEL_TRACE) {
+        Logger::GetInstance().AttachModule(this);
+    }
+
+    ~LogModule() { Logger::GetInstance().DetachModule(this); }
+
+    bool Enabled(int level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    const char* name() const { return name_; }
+
+private:
+    friend class Logger;
+    const char* name_;
+    std::atomic<int> level_;
+};
+
+inline void Logger::AttachModule(LogModule* module) {
+    std::lock_guard<std::mutex> guard(level_mutex_);
+    modules_.insert(std::make_pair(std::string(module->name_), module));
+    std::map<std::string, int>::const_iterator it = overrides_.find(module->name_);
+    module->level_.store(it != overrides_.end() ? it->second : global_level_,
+                         std::memory_order_relaxed);
+}
+
+inline void Logger::DetachModule(LogModule* module) {
+    std::lock_guard<std::mutex> guard(level_mutex_);
+    typedef std::multimap<std::string, LogModule*>::iterator Iter;
+    std::pair<Iter, Iter> range = modules_.equal_range(module->name_);
+    for (Iter it = range.first; it != range.second; ++it) {
+        if (it->second == module) {
+            modules_.erase(it);
+            return;
+        }
+    }
+}
+
+inline void Logger::ApplyLevels() {
+    typedef std::multimap<std::string, LogModule*>::iterator Iter;
+    for (Iter it = modules_.begin(); it != modules_.end(); ++it) {
+        std::map<std::string, int>::const_iterator o = overrides_.find(it->first);
+        it->second->level_.store(o != overrides_.end() ? o->second : global_level_,
+                                 std::memory_order_relaxed);
+    }
+}
+
+static LogModule log_module_(LOG_MODULE);
+
+// 结构化日志：fmt 必须是字符串字面量，参数原样拷贝，格式化推迟到后台线程
+#define LOG_FMT(fmt, ...)                                                              \
+    do {                                                                               \
+        static std::atomic<uint32_t> log_site_id_(0);                                  \
+        Logger::GetInstance().Log(log_site_id_, LOG_LEVEL_NONE, fmt, __FILE__, __LINE__, \
+                                  ##__VA_ARGS__);                                      \
+    } while (0)
+
+// 带级别的结构化日志：先比较本模块的运行期级别，通过后才求值参数
+#define LOG_AT(level, fmt, ...)                                                        \
+    do {                                                                               \
+        if (log_module_.Enabled(level)) {                                              \
+            static std::atomic<uint32_t> log_site_id_(0);                              \
+            Logger::GetInstance().Log(log_site_id_, level, fmt, __FILE__, __LINE__,    \
+                                      ##__VA_ARGS__);                                  \
+        }                                                                              \
+    } while (0)
+
+// 低于编译期级别的语句展开为空，参数表达式不会出现在生成的代码中
+#define LOG_DISABLED(fmt, ...) do { } while (0)
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(fmt, ...) LOG_AT(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_FATAL
+#define LOG_FATAL(fmt, ...) LOG_AT(LOG_LEVEL_FATAL, fmt, ##__VA_ARGS__)
+#else
+#define LOG_FATAL(fmt, ...) LOG_DISABLED(fmt, ##__VA_ARGS__)
+#endif
+
+#endif
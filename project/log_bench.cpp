@@ -0,0 +1,99 @@
+// 日志性能测试：比较同步 WriteLog、异步 WriteLog 与延迟格式化 LOG_FMT 的
+// 消息吞吐量和调用点延迟，以及被运行期级别过滤掉的 LOG_DEBUG 的开销。
+//
+// 编译：g++ -std=c++11 -O2 log_bench.cpp -o log_bench -pthread -lz
+// 用法：./log_bench [线程数] [每线程消息数]
+// 延迟为每次调用前后各取一次 steady_clock 的差值，包含一次取时间的开销（见 clock 一行）。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+
+typedef std::chrono::steady_clock Clock;
+
+enum Mode { kSync, kAsyncText, kFmtText, kFmtBinary, kFiltered };
+
+static const char* kModeNames[] = {
+    "sync WriteLog", "async WriteLog", "async LOG_FMT", "async LOG_FMT binary",
+    "filtered LOG_DEBUG"
+};
+
+static inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count();
+}
+
+static void Producer(Mode mode, int id, int count, std::vector<uint32_t>* latency) {
+    Logger& logger = Logger::GetInstance();
+    latency->resize(count);
+    for (int i = 0; i < count; ++i) {
+        uint64_t start = NowNs();
+        if (mode == kSync || mode == kAsyncText) {
+            logger.WriteLog("Thread " + std::to_string(id) + " request " + std::to_string(i) +
+                            " took " + std::to_string(i * 0.5) + " ms, status ok");
+        } else if (mode == kFiltered) {
+            LOG_DEBUG("Thread %d request %d took %f ms, status %s", id, i, i * 0.5, "ok");
+        } else {
+            LOG_FMT("Thread %d request %d took %f ms, status %s", id, i, i * 0.5, "ok");
+        }
+        (*latency)[i] = static_cast<uint32_t>(NowNs() - start);
+    }
+}
+
+static void Run(Mode mode, int threads, int count) {
+    AsyncOptions options;
+    options.buffer_size = 1 << 20;
+    options.binary = mode == kFmtBinary;
+    if (mode != kSync)
+        Logger::GetInstance().StartAsync(options);
+
+    std::vector<std::vector<uint32_t> > latency(threads);
+    std::vector<std::thread> workers;
+    uint64_t begin = NowNs();
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(std::thread(Producer, mode, t, count, &latency[t]));
+    for (int t = 0; t < threads; ++t)
+        workers[t].join();
+    uint64_t produced = NowNs();
+    Logger::GetInstance().StopAsync();
+    uint64_t written = NowNs();
+
+    std::vector<uint32_t> all;
+    for (int t = 0; t < threads; ++t)
+        all.insert(all.end(), latency[t].begin(), latency[t].end());
+    std::sort(all.begin(), all.end());
+    double total = static_cast<double>(threads) * count;
+    printf("%-22s %10.2f %10.2f %8u %8u %8u %8u\n", kModeNames[mode],
+           total / (produced - begin) * 1e3, total / (written - begin) * 1e3,
+           all[all.size() / 2], all[all.size() * 99 / 100], all[all.size() * 999 / 1000],
+           all.back());
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int count = argc > 2 ? atoi(argv[2]) : 200000;
+    unlink("log.txt");
+    unlink("log.bin");
+
+    uint64_t clock_cost = NowNs();
+    for (int i = 0; i < 1000000; ++i)
+        NowNs();
+    clock_cost = (NowNs() - clock_cost) / 1000000;
+
+    printf("threads=%d messages/thread=%d clock=%lluns\n", threads, count,
+           static_cast<unsigned long long>(clock_cost));
+    printf("%-22s %10s %10s %8s %8s %8s %8s\n", "mode", "call Mops", "e2e Mops",
+           "p50 ns", "p99 ns", "p999 ns", "max ns");
+    Run(kSync, threads, count);
+    Run(kAsyncText, threads, count);
+    Run(kFmtText, threads, count);
+    Run(kFmtBinary, threads, count);
+    Run(kFiltered, threads, count);
+    return 0;
+}
@@ -0,0 +1,87 @@
+// 二进制日志解码工具：把异步二进制模式写出的 log.bin 还原成文本
+//
+// 用法：./log_decode [log.bin]，结果输出到标准输出
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+
+#include "log.h"
+
+// 解码时格式串来自文件中的字典记录，需要自己持有字符串
+struct DecodedFormat {
+    std::string fmt;
+    std::string file;
+    LogFormat format;
+};
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : "log.bin";
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << path << std::endl;
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(kLogBinaryMagic) ||
+        memcmp(data.data(), kLogBinaryMagic, sizeof(kLogBinaryMagic)) != 0) {
+        std::cerr << path << ": not a binary log file" << std::endl;
+        return 1;
+    }
+
+    std::map<uint32_t, DecodedFormat> formats;
+    std::string line;
+    size_t pos = sizeof(kLogBinaryMagic);
+    while (pos + 2 * sizeof(uint32_t) <= data.size()) {
+        uint32_t head[2];
+        memcpy(head, data.data() + pos, sizeof(head));
+        // mmap 方式写入时进程崩溃，文件尾部会留下预分配的 0 字节
+        if (head[0] == 0 && head[1] == 0 &&
+            data.find_first_not_of('\0', pos) == std::string::npos)
+            break;
+        pos += sizeof(head);
+        if (head[1] > data.size() - pos) {
+            std::cerr << "truncated record at offset " << pos << std::endl;
+            return 1;
+        }
+        const char* body = data.data() + pos;
+        pos += head[1];
+
+        if (head[0] == kLogDictionaryId) {
+            // [uint32 id][int32 line][int32 level][types\0][file\0][fmt\0]
+            uint32_t id;
+            int32_t meta[2];
+            memcpy(&id, body, sizeof(id));
+            memcpy(meta, body + sizeof(id), sizeof(meta));
+            const char* p = body + sizeof(id) + sizeof(meta);
+            DecodedFormat& f = formats[id];
+            f.format.types = p;
+            p += f.format.types.size() + 1;
+            f.file = p;
+            p += f.file.size() + 1;
+            f.fmt = p;
+            f.format.fmt = f.fmt.c_str();
+            f.format.file = f.file.c_str();
+            f.format.line = meta[0];
+            f.format.level = meta[1];
+            continue;
+        }
+
+        line.clear();
+        if (head[0] == 0) {
+            line.append(body, head[1]);
+        } else {
+            std::map<uint32_t, DecodedFormat>::const_iterator it = formats.find(head[0]);
+            if (it == formats.end()) {
+                std::cerr << "unknown format id " << head[0] << std::endl;
+                continue;
+            }
+            LogFormatArgs(it->second.format, body, head[1], line);
+        }
+        line.push_back('\n');
+        std::cout.write(line.data(), line.size());
+    }
+    return 0;
+}
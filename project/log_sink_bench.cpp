@@ -0,0 +1,118 @@
+// 日志输出方式性能测试：比较原来的 ofstream + endl、ofstream + '\n'、
+// LogFile 的 write() 批量写和 mmap 写，输出吞吐量（GB/s）和 fdatasync 的次数与耗时。
+//
+// 编译：g++ -std=c++11 -O2 log_sink_bench.cpp -o log_sink_bench -pthread -lz
+// 用法：./log_sink_bench [写入总量 MB] [fdatasync 间隔 ms，0 表示不主动刷盘]
+// 数据写入当前目录的 sink_bench.log，测试结束后删除。
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "log.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kPath = "sink_bench.log";
+static const size_t kBatchSize = 256 * 1024;
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 生成一条 100 字节左右的日志行
+static std::string MakeLine(size_t i) {
+    char buf[128];
+    int n = snprintf(buf, sizeof(buf),
+                     "2024-01-01 12:00:00.000000 INFO worker %zu handled request %zu in %zu us\n",
+                     i % 16, i, i % 1000);
+    return std::string(buf, n);
+}
+
+static void Report(const char* name, size_t bytes, double seconds, uint64_t syncs,
+                   uint64_t sync_ns_total, uint64_t sync_ns_max) {
+    printf("%-24s %8.3f GB/s %8.2f s %8llu %10.1f %10.1f\n", name,
+           bytes / seconds / 1e9, seconds, static_cast<unsigned long long>(syncs),
+           syncs ? sync_ns_total / 1e3 / syncs : 0.0, sync_ns_max / 1e3);
+}
+
+// 原实现：每行 << std::endl，即每行一次 flush（一次 write 系统调用）
+static void BenchOfstream(const char* name, size_t total, int sync_ms, bool endl) {
+    unlink(kPath);
+    std::ofstream file(kPath, std::ios::out | std::ios::app);
+    Clock::time_point start = Clock::now();
+    Clock::time_point last_sync = start;
+    uint64_t syncs = 0, sync_total = 0, sync_max = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; bytes < total; ++i) {
+        std::string line = MakeLine(i);
+        line.resize(line.size() - 1);
+        if (endl)
+            file << line << std::endl;
+        else
+            file << line << '\n';
+        bytes += line.size() + 1;
+        // ofstream 本身没有 fdatasync，周期性重新打开一个 fd 来刷盘
+        if (sync_ms > 0 && (i & 1023) == 0 &&
+            Clock::now() - last_sync >= std::chrono::milliseconds(sync_ms)) {
+            file.flush();
+            Clock::time_point s = Clock::now();
+            int fd = ::open(kPath, O_WRONLY);
+            ::fdatasync(fd);
+            ::close(fd);
+            last_sync = Clock::now();
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(last_sync - s).count();
+            ++syncs;
+            sync_total += ns;
+            if (ns > sync_max)
+                sync_max = ns;
+        }
+    }
+    file.close();
+    Report(name, bytes, Seconds(start), syncs, sync_total, sync_max);
+}
+
+// 与后台线程相同的写法：攒满一批再交给 LogFile
+static void BenchLogFile(const char* name, LogSink sink, size_t total, int sync_ms) {
+    unlink(kPath);
+    LogFile file;
+    if (!file.Open(kPath, sink, 64 * 1024 * 1024, sync_ms)) {
+        perror("open");
+        return;
+    }
+    std::string batch;
+    batch.reserve(kBatchSize + 256);
+    Clock::time_point start = Clock::now();
+    size_t bytes = 0;
+    for (size_t i = 0; bytes < total; ++i) {
+        std::string line = MakeLine(i);
+        batch += line;
+        bytes += line.size();
+        if (batch.size() >= kBatchSize) {
+            file.Write(batch.data(), batch.size());
+            batch.clear();
+            file.MaybeSync();
+        }
+    }
+    file.Write(batch.data(), batch.size());
+    file.Close();
+    Report(name, bytes, Seconds(start), file.sync_count(), file.sync_ns_total(),
+           file.sync_ns_max());
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = static_cast<size_t>(argc > 1 ? atol(argv[1]) : 1024) << 20;
+    int sync_ms = argc > 2 ? atoi(argv[2]) : 100;
+
+    printf("total=%zu MB fdatasync interval=%d ms\n", total >> 20, sync_ms);
+    printf("%-24s %13s %10s %8s %10s %10s\n", "sink", "throughput", "time", "syncs",
+           "avg us", "max us");
+    BenchOfstream("ofstream << endl", total, sync_ms, true);
+    BenchOfstream("ofstream << '\\n'", total, sync_ms, false);
+    BenchLogFile("LogFile write()", LogSink::Write, total, sync_ms);
+    BenchLogFile("LogFile mmap", LogSink::Mmap, total, sync_ms);
+    unlink(kPath);
+    return 0;
+}